@@ -3,6 +3,13 @@
 #include "registry.hpp"
 #include "http_server.hpp"
 #include "collector.hpp"
+#include "timeseries.hpp"
+#include "segment_store.hpp"
+#include "worker_pool.hpp"
+#include "timer_wheel.hpp"
+#include "log_ring.hpp"
+#include "alert_rules.hpp"
+#include "anomaly.hpp"
 
 #include <vector>
 #include <deque>
@@ -13,17 +20,12 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <map>
+#include <optional>
+#include <utility>
 
 namespace third_eye {
 
-enum class LogLevel { Info, Debug };
-
-struct LogEntry {
-    std::string timestamp;
-    std::string level;
-    std::string message;
-};
-
 struct LastError {
     std::string collector;
     std::string timestamp;
@@ -35,6 +37,21 @@ struct ProcessInfo {
     std::string name;
     double      cpu_percent;
     uint64_t    memory_bytes;
+    uint32_t    threads        = 0;
+    uint32_t    handles        = 0;   // Open handles (Windows) or file descriptors (Linux)
+    uint64_t    io_read_bytes  = 0;   // Cumulative since the process started
+    uint64_t    io_write_bytes = 0;
+    uint64_t    major_faults   = 0;   // Cumulative; all page faults on Windows
+};
+
+/// Processes rolled up by executable name, or by the root of a same-name
+/// parent chain when grouping by tree (leader_pid is 0 when by name).
+struct ProcessGroupInfo {
+    std::string name;
+    uint32_t    leader_pid;
+    uint32_t    processes;
+    double      cpu_percent;
+    uint64_t    memory_bytes;
 };
 
 struct AlertEntry {
@@ -47,18 +64,36 @@ struct AlertEntry {
     bool        active;
 };
 
-class Agent {
+class Agent : private AlertSink {
 public:
     struct Config {
         uint16_t port      = 9100;
-        int      interval  = 1;
+        uint32_t interval_ms = 1000;   // Alert evaluation / history / stream cadence
         int      top_n     = 5;
         LogLevel log_level = LogLevel::Info;
         double cpu_threshold     = 90.0;
         double memory_threshold  = 90.0;
         double collect_threshold = 2.0;
+        double core_threshold    = 95.0;   // Busiest single core, percent
+        double collector_deadline = 1.0;   // Seconds a collector may run before it counts as overrun
+        std::map<std::string, uint32_t> collector_intervals_ms;   // Overrides Collector::default_interval_ms()
+        bool     export_all_processes = false;   // Every process in /metrics, not just the top N
+        size_t   process_budget       = 1000;    // Series per process family in that mode, incl. "other"
+        bool     group_by_tree        = false;   // Group processes by parent chain instead of by name
+        std::vector<std::string> anomaly_metrics;     // Series to watch for anomalies; "*" for every gauge
+        bool        anomaly_seasonal = false;         // Hour-of-day baselines for them
+        double      anomaly_z        = 4.0;           // Standard deviations that count as anomalous
+        std::string rules_path;                       // Alert rules file; empty uses default_alert_rules()
+        std::string data_dir;                         // Persistent history; empty keeps it in memory only
+        uint64_t    data_retention_bytes = 512ULL << 20;   // Disk budget for data_dir
     };
 
+    static constexpr int      MAX_TOP_N       = 500;
+    static constexpr uint32_t MIN_INTERVAL_MS = 10;
+    static constexpr uint32_t MAX_INTERVAL_MS = 3600 * 1000;
+    static constexpr uint32_t MIN_COLLECTOR_INTERVAL_MS = 10;
+    static constexpr uint32_t MAX_COLLECTOR_INTERVAL_MS = 3600 * 1000;
+
     explicit Agent(Config config);
     ~Agent();
 
@@ -67,46 +102,123 @@ public:
     void stop();
 
     Registry& registry() { return registry_; }
-    const Config& config() const { return config_; }
+    const TimeSeriesStore& history() const { return history_; }
+    /// On-disk history, or nullptr without --data-dir (or if it failed to open).
+    const SegmentStore* disk_history() const { return disk_history_.get(); }
+    /// A copy, since interval, log level and thresholds change at runtime.
+    Config config() const;
     std::chrono::steady_clock::time_point start_time() const { return start_time_; }
 
     std::string compute_health() const;
     LastError last_error() const;
 
-    std::vector<LogEntry> get_logs(const std::string& level_filter = "", int limit = 500) const;
-    void update_config(int new_interval, const std::string& new_log_level);
-    void update_thresholds(double cpu, double mem, double collect);
+    /// Newest `limit` log records after sequence number `since`, optionally
+    /// of one level, oldest first. Returns the newest sequence number.
+    uint64_t get_logs(uint64_t since, std::optional<LogLevel> level, size_t limit,
+                      std::vector<LogRecord>& out) const;
+    void update_config(int64_t new_interval_ms, const std::string& new_log_level);
+    void update_thresholds(double cpu, double mem, double collect, double core);
+
+    /// Current period of each collector, in registration order.
+    std::vector<std::pair<std::string, uint32_t>> collector_intervals() const;
+    /// Reschedules collector `name`; false if there is no such collector.
+    bool set_collector_interval(const std::string& name, uint32_t interval_ms);
 
     std::vector<ProcessInfo> get_processes() const;
     void set_processes(std::vector<ProcessInfo> procs);
+    std::vector<ProcessGroupInfo> get_groups() const;
+    void set_groups(std::vector<ProcessGroupInfo> groups);
 
     std::vector<AlertEntry> get_alerts() const;
     std::vector<AlertEntry> active_alerts() const;
 
+    /// Replaces the alert rules with those in `text` (see AlertRules). Rules
+    /// can use $cpu_threshold, $memory_threshold, $collect_threshold and
+    /// $core_threshold. On failure returns false, sets `error` and keeps the
+    /// current rules. Call before run().
+    bool load_alert_rules(std::string_view text, std::string& error);
+    size_t alert_rule_count() const { return alert_rules_.size(); }
+
     void log_info(const std::string& msg);
     void log_debug(const std::string& msg);
     void log_error(const std::string& msg);
 
 private:
-    void collect_all();
+    void schedule_loop();
+    void dispatch(size_t index);
+    void check_deadlines();
+    void evaluate_cycle();
+    uint32_t interval_ms_of(size_t index) const;   // index == collectors_.size(): the evaluation pass
+    uint32_t schedule_tick_ms() const;
+    void run_collector(size_t index);
+    void record_error(const std::string& collector, const std::string& message);
     void register_agent_metrics();
-    void add_log(const std::string& level, const std::string& msg);
+    void add_log(LogLevel level, const std::string& msg);
     void evaluate_alerts();
+    uint64_t raise_alert(std::string_view rule, std::string_view severity, std::string message,
+                         double value, double threshold) override;
+    void clear_alert(uint64_t id) override;
+
+    struct CollectorSlot {
+        GaugeHandle   duration;
+        CounterHandle errors;
+        // Set while a run is queued or executing; a busy collector is not
+        // dispatched again until its previous run returns.
+        std::atomic<bool> busy{false};
+        std::atomic<bool> overrun{false};
+        std::chrono::steady_clock::time_point started{};
+        std::atomic<uint32_t> interval_ms{1000};
+    };
 
+    // interval_ms, log_level and the thresholds are set from HTTP workers;
+    // read and write them under config_mutex_.
+    mutable std::mutex config_mutex_;
     Config config_;
+    // The thresholds as the rule VM sees them, bound by address as
+    // $variables. Copied from config_ at the start of each evaluation pass,
+    // so only the evaluation thread touches them.
+    struct RuleThresholds {
+        double cpu, memory, collect, core;
+    } rule_thresholds_;
     Registry registry_;
     std::vector<std::unique_ptr<Collector>> collectors_;
+    std::deque<CollectorSlot> collector_slots_;   // parallel to collectors_
+    std::unique_ptr<WorkerPool> pool_;
+
+    GaugeHandle collect_duration_;
+    GaugeHandle agent_uptime_;
+    GaugeHandle scrape_duration_;
+    GaugeHandle history_bytes_;
+    CounterHandle missed_ticks_;
+    CounterHandle late_ticks_;
+    GaugeHandle   tick_lag_;
+    GaugeHandle history_disk_bytes_;
+    CounterHandle history_dropped_;
+    TimeSeriesStore history_;
+    std::unique_ptr<SegmentStore> disk_history_;
+    bool disk_write_failed_ = false;   // Logged once; cleared when a write succeeds again
     std::unique_ptr<HttpServer> server_;
 
+    // Bumped after every collector run and evaluation pass. A scrape within
+    // the same generation is served the registry's last exposition as-is,
+    // so the agent's own uptime and scrape gauges do not make every body
+    // unique. Only the generation is kept, not the buffer, so the registry
+    // can keep patching it in place.
+    std::atomic<uint64_t> collect_generation_{0};
+    std::mutex            scrape_mutex_;
+    uint64_t              scrape_generation_ = 0;
+    bool                  scraped_           = false;
+
     std::atomic<bool>       running_{false};
     std::mutex              cv_mutex_;
     std::condition_variable cv_;
+    std::atomic<bool>       schedule_dirty_{false};   // Periods changed; rebuild the wheel
 
     std::chrono::steady_clock::time_point start_time_;
 
     static constexpr size_t MAX_LOG_ENTRIES = 2000;
-    mutable std::mutex log_mutex_;
-    std::deque<LogEntry> log_buffer_;
+    LogRing          log_ring_{MAX_LOG_ENTRIES};
+    ConsoleLogWriter console_{log_ring_};   // After log_ring_: drains it on destruction
 
     mutable std::mutex error_mutex_;
     LastError last_error_;
@@ -114,13 +226,15 @@ private:
 
     mutable std::mutex process_mutex_;
     std::vector<ProcessInfo> processes_;
+    std::vector<ProcessGroupInfo> groups_;
 
     static constexpr size_t MAX_ALERT_HISTORY = 100;
     mutable std::mutex alert_mutex_;
     std::deque<AlertEntry> alert_history_;
-    std::chrono::steady_clock::time_point last_cpu_alert_{};
-    std::chrono::steady_clock::time_point last_mem_alert_{};
-    std::chrono::steady_clock::time_point last_collect_alert_{};
+    uint64_t next_alert_id_ = 1;   // Id of the next entry; alert_history_.back() has next_alert_id_ - 1
+    AlertRules alert_rules_;       // Only touched by the evaluation pass once running
+    AnomalyDetector anomalies_;    // Likewise
+    GaugeHandle anomaly_series_;
 };
 
 }
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace third_eye {
+
+class Registry;
+struct MetricSeries;
+
+
+/// Rules the agent evaluates when no --rules file is given. They reproduce
+/// the built-in cpu_high, memory_high, collect_slow and cpu_core_saturated
+/// alerts, with thresholds read from the live configuration.
+std::string_view default_alert_rules();
+
+/// Named numbers a rule can refer to as $name. Read at every evaluation, so
+/// changing the pointee (e.g. through POST /api/config) takes effect at once.
+using RuleVariables = std::vector<std::pair<std::string, const double*>>;
+
+
+/// Receives the alerts a rule set raises and clears.
+class AlertSink {
+public:
+    virtual ~AlertSink() = default;
+
+    /// Records a new active alert and returns an id for clear_alert().
+    virtual uint64_t raise_alert(std::string_view rule, std::string_view severity, std::string message,
+                                 double value, double threshold) = 0;
+    virtual void clear_alert(uint64_t id) = 0;
+};
+
+
+/// Alert rules compiled to bytecode over registry series.
+///
+/// A rules file is a list of "key: value" lines; each `alert:` line starts
+/// a rule, '#' starts a comment:
+///
+///     alert:    memory_high
+///     expr:     the_third_eye_memory_used_bytes / the_third_eye_memory_total_bytes * 100 > $memory_threshold
+///     for:      30s                    # must hold this long before it fires (default 0)
+///     cooldown: 30s                    # re-raise, replacing the alert, at most this often (default: never)
+///     severity: warning                # default warning
+///     message:  {name}: {value}% > {threshold}%
+///
+/// `expr` is one comparison (>, >=, <, <=, ==, !=) between two arithmetic
+/// expressions of numbers, $variables, series selectors and functions:
+///
+///     name                     every series of the metric
+///     name{k="v",k2!="v"}      only series whose labels match
+///     rate(selector)           per-second change since the previous pass
+///     max|min|sum|avg(sel)     one number over all matching series
+///     count(selector)          number of matching series
+///
+/// The first selector not inside an aggregation drives the rule: it is
+/// evaluated, and fires, once per series that selector matches, with
+/// {labels} in the message set to that series' labels. Other bare
+/// selectors read their first match. Anything that has no value (a missing
+/// series, a first rate() sample, a division by zero) makes the comparison
+/// false.
+///
+/// Selectors are bound to series once. When the registry layout changes,
+/// only selectors whose own metric gained or lost a series are rebound
+/// (which allocates). Otherwise a pass samples each bound series once, runs
+/// a few instructions per series and allocates nothing unless an alert
+/// changes state.
+class AlertRules {
+public:
+    AlertRules();
+    ~AlertRules();
+
+    AlertRules(const AlertRules&) = delete;
+    AlertRules& operator=(const AlertRules&) = delete;
+    AlertRules(AlertRules&&) noexcept;
+    AlertRules& operator=(AlertRules&&) noexcept;
+
+    /// Parses and compiles `text`. On failure returns false, sets `error`
+    /// (with the line number) and leaves the current rules untouched.
+    bool load(std::string_view text, const RuleVariables& vars, std::string& error);
+
+    /// Evaluates every rule against `registry` at monotonic time `now_ms`,
+    /// reporting state changes to `sink`.
+    void evaluate(const Registry& registry, int64_t now_ms, AlertSink& sink);
+
+    [[nodiscard]] size_t size() const;
+
+private:
+    struct Rule;
+
+    void bind(const Registry& registry);
+
+    std::vector<Rule> rules_;
+    uint64_t bound_epoch_ = UINT64_MAX;
+};
+
+}
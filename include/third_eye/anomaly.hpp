@@ -0,0 +1,93 @@
+#pragma once
+
+#include "alert_rules.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace third_eye {
+
+class Registry;
+struct MetricSeries;
+
+
+/// Online anomaly detection over registry gauges.
+///
+/// Every tracked series keeps an exponentially weighted mean and variance
+/// of its samples, spanning about `window_ms`. With `seasonal`, it also
+/// keeps one per hour of the (local) day, learnt over about a week; once an
+/// hour has been seen in full, its baseline replaces the global one during
+/// that hour, so a host that is busy every night at 02:00 is not flagged
+/// for it. Both are weighted by time, so they keep their span when the
+/// update interval changes.
+///
+/// A series turns anomalous after `streak` consecutive samples more than
+/// `z` standard deviations from its baseline, and recovers once a sample is
+/// back within z/2. Each transition raises or clears an "anomaly" alert.
+///
+/// State is a flat array of small fixed-size records, so each sample is
+/// O(1) and memory is constant per series: 32 bytes, plus 288 with
+/// `seasonal`.
+class AnomalyDetector {
+public:
+    struct Options {
+        std::vector<std::string> metrics;           // Names to track; "*" tracks every gauge
+        double   z        = 4.0;                    // Deviations from the baseline that count as anomalous
+        uint32_t window_ms   = 600 * 1000;          // Span of the global baseline
+        uint32_t interval_ms = 1000;                // Between update() calls
+        uint32_t warmup   = 60;                     // Samples before a series can be flagged
+        uint32_t streak   = 3;                      // Consecutive anomalous samples before raising
+        bool     seasonal = false;                  // Hour-of-day baseline
+    };
+
+    explicit AnomalyDetector(Options options);
+
+    /// Rescales the sample weights after the update interval changed.
+    void set_interval(uint32_t interval_ms);
+
+    /// Feeds the current value of every tracked series, reporting alert
+    /// transitions to `sink`. `hour` is the local hour of day (0-23).
+    void update(const Registry& registry, int hour, AlertSink& sink);
+
+    [[nodiscard]] size_t series_count() const { return states_.size(); }
+    [[nodiscard]] bool enabled() const { return !options_.metrics.empty(); }
+
+private:
+    struct State {
+        uint32_t id       = 0;
+        uint32_t samples  = 0;
+        float    mean     = 0.0f;
+        float    var      = 0.0f;
+        uint64_t alert    = 0;       // Sink id while anomalous
+        uint16_t streak   = 0;
+        bool     anomalous = false;
+    };
+    struct HourStat {
+        float    mean       = 0.0f;
+        float    var        = 0.0f;
+        uint32_t covered_ms = 0;   // Time its samples account for, saturating
+    };
+    static constexpr size_t   HOURS   = 24;
+    static constexpr uint32_t HOUR_MS = 3600 * 1000;
+
+    void bind(const Registry& registry, AlertSink& sink);
+    bool tracks(const std::string& name) const;
+
+    Options options_;
+    bool    all_ = false;
+    std::unordered_set<std::string> names_;
+    double  alpha_          = 0.0;   // EWMA weight of one sample, from window_ms / interval_ms
+    double  seasonal_alpha_ = 0.0;   // Same for an hour's baseline, over a week
+
+    // Parallel, one entry per tracked series, in registry order.
+    std::vector<State>               states_;
+    std::vector<HourStat>            hours_;    // HOURS per series, with `seasonal`
+    std::vector<const MetricSeries*> series_;
+    std::vector<std::string>         labels_;   // "name{labels}", for messages
+    uint64_t bound_epoch_ = UINT64_MAX;
+};
+
+}
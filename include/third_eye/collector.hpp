@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 
 namespace third_eye {
 
@@ -14,6 +15,9 @@ public:
 
     [[nodiscard]] virtual std::string name() const = 0;
 
+    /// How often the agent runs this collector unless configured otherwise.
+    [[nodiscard]] virtual uint32_t default_interval_ms() const { return 1000; }
+
     /// Implementations must be exception-safe: throw on fatal errors only.
     virtual void collect(Registry& registry) = 0;
 };
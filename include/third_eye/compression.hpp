@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace third_eye {
+
+/// Response body encodings. Gzip needs zlib and zstd needs libzstd at build
+/// time (THIRD_EYE_HAVE_ZLIB / THIRD_EYE_HAVE_ZSTD); without them only
+/// Identity is ever negotiated.
+enum class ContentEncoding : uint8_t { Identity = 0, Gzip, Zstd };
+
+inline constexpr size_t CONTENT_ENCODING_COUNT = 3;
+
+/// Token for the Content-Encoding header, or nullptr for Identity.
+const char* content_encoding_name(ContentEncoding enc);
+
+/// Picks the encoding for an Accept-Encoding header value: the supported
+/// coding with the highest q-value, zstd before gzip on a tie. "*" counts
+/// for both, and q=0 rules a coding out.
+ContentEncoding negotiate_encoding(std::string_view accept_encoding);
+
+/// Compresses `in` into `out` (replacing its contents). Returns false if
+/// the encoding is not compiled in or the compressor failed.
+bool compress_body(ContentEncoding enc, std::string_view in, std::string& out);
+
+}
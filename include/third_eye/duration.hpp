@@ -0,0 +1,39 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+namespace third_eye {
+
+
+/// Parses a non-negative duration such as "250ms", "1.5s", "2m" or "1h" into
+/// milliseconds. A bare number is taken in `bare_unit_ms` units (seconds by
+/// default, so "2" still means two seconds). Returns false on malformed
+/// input, and on nan, inf or anything too large for an int64_t millisecond count.
+inline bool parse_duration_ms(std::string_view text, int64_t& out, double bare_unit_ms = 1000.0) {
+    while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+    while (!text.empty() && text.back()  == ' ') text.remove_suffix(1);
+
+    double v = 0.0;
+    auto [p, ec] = std::from_chars(text.data(), text.data() + text.size(), v);
+    if (ec != std::errc{} || v < 0.0) return false;
+
+    std::string_view unit(p, static_cast<size_t>(text.data() + text.size() - p));
+    double scale;
+    if (unit.empty())      scale = bare_unit_ms;
+    else if (unit == "ms") scale = 1.0;
+    else if (unit == "s")  scale = 1000.0;
+    else if (unit == "m")  scale = 60e3;
+    else if (unit == "h")  scale = 3600e3;
+    else return false;
+
+    double ms = v * scale;
+    if (!std::isfinite(ms) || ms > static_cast<double>(INT64_MAX / 2)) return false;
+    out = static_cast<int64_t>(ms + 0.5);
+    return true;
+}
+
+}
@@ -1,20 +1,54 @@
 #pragma once
 
+#include "registry.hpp"
+#include "compression.hpp"
+
 #include <string>
+#include <string_view>
+#include <memory>
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
 #include <cstdint>
 
 namespace third_eye {
 
-class Registry;
 class Agent;
+enum class LogLevel : uint8_t;
+struct AlertEntry;
+
+
+/// A parsed request. Views point into the connection's input buffer and are
+/// only valid while the request is being routed.
+struct HttpRequest {
+    std::string_view method;
+    std::string_view path;
+    std::string_view query;
+    std::string_view body;
+    bool             keep_alive = true;
+    ContentEncoding  accept_encoding = ContentEncoding::Identity;   // Negotiated from Accept-Encoding
+};
+
+
+struct HttpResponse {
+    int         code = 200;
+    std::string content_type;
+    std::string body;
+    std::shared_ptr<const std::string> shared_body;   // Takes precedence over body
+    uint64_t    body_version = 0;                      // Exposition::version of shared_body; 0 if none
+    bool        stream = false;                        // text/event-stream; body is the first frame
+    ContentEncoding encoding = ContentEncoding::Identity;   // Of the payload, for Content-Encoding
+
+    [[nodiscard]] const std::string& payload() const { return shared_body ? *shared_body : body; }
+};
 
 
 class HttpServer {
 public:
-    using MetricsProvider = std::function<std::string()>;
+    using MetricsProvider = std::function<Exposition()>;
 
     explicit HttpServer(uint16_t port, MetricsProvider provider,
                         Registry* registry = nullptr, Agent* agent = nullptr);
@@ -23,25 +57,77 @@ public:
     void start();
     void stop();
 
+    /// Server-Sent Events pushed to every GET /api/stream client. Each is a
+    /// no-op (one atomic load) while no client is connected.
+    void publish_metrics();
+    void publish_log(uint64_t seq, LogLevel level, int64_t timestamp_ms, std::string_view message);
+    void publish_alert(const AlertEntry& alert, bool fired);
+
 private:
+    struct Connection;
+
+    // Windows: select() on the listen socket, one client at a time.
     void accept_loop();
     void handle_client(uintptr_t client_socket);
+    void send_response(uintptr_t sock, HttpResponse& resp);
 
+    // Linux: worker threads sharing one epoll set with EPOLLONESHOT, so a
+    // connection is only ever serviced by one worker at a time.
+    void event_loop();
+    void accept_pending();
+    void service(Connection* conn, uint32_t events);
+    void close_connection(Connection* conn);
 
-    void send_response(uintptr_t sock, int code, const std::string& content_type,
-                       const std::string& body);
+    void attach_stream(std::unique_ptr<Connection> conn);
+    void broadcast(std::string_view event, std::string_view data);
+
+    HttpResponse route(const HttpRequest& req);
+    void compress(const HttpRequest& req, HttpResponse& resp);
     std::string handle_api_status();
-    std::string handle_api_logs(const std::string& query);
+    std::string handle_api_logs(std::string_view query);
     std::string handle_api_config_post(const std::string& body);
     std::string handle_api_alerts();
+    HttpResponse handle_api_query_range(std::string_view query);
+    HttpResponse handle_api_snapshot_bin(std::string_view query);
+
+    static constexpr size_t MAX_CONNECTIONS = 256;
+    static constexpr size_t MAX_STREAMS     = 64;
+    static constexpr size_t MIN_COMPRESS_BYTES = 1024;
 
     uint16_t        port_;
     MetricsProvider provider_;
     Registry*       registry_ = nullptr;
     Agent*          agent_    = nullptr;
+    CounterHandle   metrics_requests_;
+    CounterHandle   status_requests_;
+    CounterHandle   snapshot_requests_;
+    CounterHandle   compress_hits_;
+    CounterHandle   compress_misses_;
     std::atomic<bool> running_{false};
-    std::jthread    thread_;
+    std::vector<std::jthread> threads_;
     uintptr_t       listen_socket_{static_cast<uintptr_t>(-1)};
+    std::string     recv_buf_;   // Windows: request buffer reused across clients
+
+    int epoll_fd_ = -1;
+    int wake_fd_  = -1;
+    std::mutex conn_mutex_;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+
+    std::mutex stream_mutex_;
+    std::vector<std::unique_ptr<Connection>> streams_;
+    std::atomic<size_t> stream_count_{0};
+    std::unordered_map<std::string, double> pushed_values_;   // Last value sent per status key
+    std::unordered_map<std::string, std::string> pushed_sections_;   // Last JSON sent per object/array key
+
+    /// Last compressed form of the exposition, per encoding, keyed by its
+    /// version rather than by holding the source buffer, which the registry
+    /// could then no longer patch in place.
+    struct CompressedBody {
+        uint64_t                           version = 0;
+        std::shared_ptr<const std::string> body;
+    };
+    std::mutex     compress_mutex_;
+    CompressedBody compressed_[CONTENT_ENCODING_COUNT];
 };
 
 }
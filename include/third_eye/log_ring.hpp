@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace third_eye {
+
+/// Severity of a log record. Info and Debug double as the configured
+/// verbosity; Error is only ever a record level.
+enum class LogLevel : uint8_t { Info, Debug, Error };
+
+/// "INFO", "DEBUG" or "ERROR".
+const char* log_level_name(LogLevel level);
+/// Inverse of log_level_name(); nullopt for anything else.
+std::optional<LogLevel> parse_log_level(std::string_view name);
+
+/// Formats a Unix millisecond timestamp as local "YYYY-MM-DD HH:MM:SS" into
+/// `buf` and returns a view of it.
+std::string_view format_log_time(int64_t timestamp_ms, char (&buf)[32]);
+
+
+/// One fixed-size log record; messages longer than MAX_MESSAGE bytes are
+/// truncated.
+struct LogRecord {
+    static constexpr size_t MAX_MESSAGE = 480;
+
+    uint64_t seq = 0;            // 1, 2, 3, ... in write order
+    int64_t  timestamp_ms = 0;   // Unix milliseconds
+    LogLevel level = LogLevel::Info;
+    uint16_t length = 0;
+    char     text[MAX_MESSAGE];
+
+    [[nodiscard]] std::string_view message() const { return {text, length}; }
+};
+
+
+/// Preallocated ring of the most recent log records.
+///
+/// Writers take the lock only to copy one record into its slot, so logging
+/// never allocates. Every record carries a monotonic sequence number, which
+/// lets readers ask for just the records after the last one they saw.
+class LogRing {
+public:
+    explicit LogRing(size_t capacity);
+
+    /// Appends a record and returns its sequence number.
+    uint64_t push(LogLevel level, int64_t timestamp_ms, std::string_view message);
+
+    /// Copies into `out` (replacing its contents), oldest first, the newest
+    /// `limit` records with a sequence number above `since` and, if given,
+    /// the matching level. Returns the sequence number of the newest record
+    /// in the ring, for the next call's `since`.
+    uint64_t read(uint64_t since, std::optional<LogLevel> level, size_t limit,
+                  std::vector<LogRecord>& out) const;
+
+    /// Blocks until a record newer than `seq` exists or `stop` is requested.
+    void wait_after(uint64_t seq, std::stop_token stop) const;
+
+    [[nodiscard]] uint64_t last_seq() const;
+    [[nodiscard]] size_t capacity() const { return slots_.size(); }
+
+private:
+    mutable std::mutex mutex_;
+    mutable std::condition_variable_any cv_;
+    std::vector<LogRecord> slots_;   // Record `seq` lives in slot (seq - 1) % capacity
+    uint64_t next_seq_ = 1;
+};
+
+
+/// Background thread that copies new records from a LogRing to stdout
+/// (stderr for errors), so that logging never waits on the console. If it
+/// falls a whole ring behind, it reports how many lines it skipped.
+class ConsoleLogWriter {
+public:
+    explicit ConsoleLogWriter(const LogRing& ring);
+    /// Writes whatever is still pending, then stops.
+    ~ConsoleLogWriter();
+
+private:
+    void run(std::stop_token stop);
+    void drain();
+
+    const LogRing& ring_;
+    uint64_t written_ = 0;
+    std::vector<LogRecord> batch_;
+    std::jthread thread_;
+};
+
+}
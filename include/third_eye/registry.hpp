@@ -2,8 +2,15 @@
 
 #include <string>
 #include <vector>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <unordered_map>
+#include <string_view>
+#include <mutex>
 #include <shared_mutex>
 
 namespace third_eye {
@@ -15,16 +22,81 @@ enum class MetricType {
 };
 
 
+/// Counter storage split into per-thread cells, each on its own cache line.
+///
+/// Writers add to the cell picked by their thread, so increments from the
+/// HTTP threads and the collection thread never bounce the same line or
+/// take a lock; readers sum all cells, which only happens at scrape time.
+class ShardedCounter {
+public:
+    static constexpr size_t kShards = 16;
+
+    void add(double delta) {
+        cells_[shard_index()].value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] double sum() const {
+        double total = 0.0;
+        for (const auto& c : cells_) total += c.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<double> value{0.0};
+    };
+
+    static size_t shard_index();
+
+    Cell cells_[kShards];
+};
+
+
 struct MetricSeries {
-    std::string labels;   // Pre-formatted: {key="val",...} or empty
-    double      value = 0.0;
+    MetricSeries(const std::string& name, std::string l, double v, MetricType type)
+        : labels(std::move(l)), value(v), prefix(name + labels + ' ') {
+        if (type == MetricType::Counter) {
+            counter = std::make_unique<ShardedCounter>();
+            counter->add(v);
+        }
+    }
+
+    /// Gauges read `value`; counters sum their cells.
+    [[nodiscard]] double current() const {
+        return counter ? counter->sum() : value.load(std::memory_order_relaxed);
+    }
+
+    std::string         labels;   // Pre-formatted: {key="val",...} or empty
+    std::atomic<double> value{0.0};
+    uint32_t            id = 0;   // Stable while the series exists; never reused
+    std::unique_ptr<ShardedCounter> counter;   // Counters only
+
+    // Series dropped by gauge_replace_all stay in the deque, inactive, and
+    // are recycled (with a fresh id) for the next new label set.
+    bool     active  = true;
+    uint32_t touched = 0;         // gauge_replace_all pass that last matched it
+
+    // Exposition cache, maintained by Registry::exposition() under its cache lock.
+    std::string      prefix;                   // "name{labels} "
+    mutable bool     rendered      = false;
+    mutable uint8_t  value_len     = 0;
+    mutable uint64_t rendered_bits = 0;
+    mutable size_t   value_offset  = 0;        // Into the cached exposition buffer
+    mutable char     value_text[32]{};
 };
 
 
 struct MetricEntry {
     MetricType  type;
     std::string help;
-    std::vector<MetricSeries> series;
+    std::string header;   // Pre-rendered "# HELP ...\n# TYPE ...\n"
+    // deque: series never move once created, so handles can point into it.
+    std::deque<MetricSeries> series;
+    // Active series by label set; keys view each series' own labels string.
+    std::unordered_map<std::string_view, MetricSeries*> index;
+    size_t active = 0;
+    size_t free   = 0;            // Inactive series available for reuse
+    uint64_t epoch = 0;           // Layout epoch of its last added or removed series
 };
 
 
@@ -34,21 +106,103 @@ struct MetricSnapshot {
     double      value;
 };
 
+/// A rendered exposition. `version` changes whenever the bytes do, so
+/// caches key on it instead of holding on to the buffer: a buffer nobody
+/// holds is patched in place, one that is still referenced has to be copied.
+struct Exposition {
+    std::shared_ptr<const std::string> body;
+    uint64_t version = 0;
+};
+
+
+/// Pre-resolved reference to a single gauge series.
+///
+/// Resolve once (per label set) through Registry::register_gauge() or
+/// Registry::gauge_handle(); after that set() is one relaxed atomic store,
+/// with no name hashing, no label comparison and no registry lock.
+/// A default-constructed handle is inert.
+class GaugeHandle {
+public:
+    GaugeHandle() = default;
+
+    void set(double v) const {
+        if (series_) series_->value.store(v, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] double value() const {
+        return series_ ? series_->value.load(std::memory_order_relaxed) : 0.0;
+    }
+
+    explicit operator bool() const { return series_ != nullptr; }
+
+private:
+    friend class Registry;
+    explicit GaugeHandle(MetricSeries* s) : series_(s) {}
+    MetricSeries* series_ = nullptr;
+};
+
+
+/// Pre-resolved reference to a single counter series; inc() is one atomic
+/// add on the calling thread's ShardedCounter cell.
+class CounterHandle {
+public:
+    CounterHandle() = default;
+
+    void inc(double delta = 1.0) const {
+        if (series_) series_->counter->add(delta);
+    }
+
+    [[nodiscard]] double value() const {
+        return series_ ? series_->counter->sum() : 0.0;
+    }
+
+    explicit operator bool() const { return series_ != nullptr; }
+
+private:
+    friend class Registry;
+    explicit CounterHandle(MetricSeries* s) : series_(s) {}
+    MetricSeries* series_ = nullptr;
+};
+
 
 class Registry {
 public:
 
     void register_metric(const std::string& name, MetricType type, const std::string& help);
 
+    /// Typed registration: registers the metric (if needed) and resolves the
+    /// series for `labels` in one step.
+    GaugeHandle register_gauge(const std::string& name, const std::string& help,
+                               const std::string& labels = "");
+
+    CounterHandle register_counter(const std::string& name, const std::string& help,
+                                   const std::string& labels = "");
+
+    /// Resolves (creating if needed) a series of an already registered metric.
+    /// Returns an inert handle if the metric is unknown or of another type.
+    [[nodiscard]] GaugeHandle gauge_handle(const std::string& name, const std::string& labels = "");
+
+    [[nodiscard]] CounterHandle counter_handle(const std::string& name, const std::string& labels = "");
+
 
     void gauge_set(const std::string& name, double value);
 
 
     void gauge_set(const std::string& name, const std::string& labels, double value);
 
+    /// Makes the series of `name` exactly `entries`. Label sets already
+    /// present are updated in place (under the shared lock when nothing was
+    /// added or dropped); dropped series are parked and recycled for new
+    /// label sets instead of being freed. Handles into a metric updated this
+    /// way are invalidated; use it only for label sets that churn.
     void gauge_replace_all(const std::string& name,
                            const std::vector<std::pair<std::string, double>>& entries);
 
+    /// Same, with labels viewed from caller-owned storage (e.g. labels cached
+    /// across cycles), so the steady state copies no strings at all.
+    void gauge_replace_all(const std::string& name,
+                           const std::vector<std::pair<std::string_view, double>>& entries);
+
 
     void counter_inc(const std::string& name, double delta = 1.0);
 
@@ -58,15 +212,79 @@ public:
 
     [[nodiscard]] std::string serialize() const;
 
+    /// Prometheus text exposition, served from a persistent buffer.
+    ///
+    /// HELP/TYPE lines and series prefixes are rendered once; on each call
+    /// only series whose value bits changed are re-formatted, and their
+    /// bytes are patched in place when the width is unchanged. If nothing
+    /// changed, the previous buffer is returned as-is.
+    [[nodiscard]] Exposition exposition() const;
+
+    /// What exposition() last returned, without re-rendering; an empty body
+    /// before the first call.
+    [[nodiscard]] Exposition last_exposition() const;
+
 
     [[nodiscard]] std::vector<MetricSnapshot> snapshot() const;
 
+    /// Appends a binary snapshot (see snapshot_format.hpp) of every active
+    /// series to `out`. The name table is left out when `known_epoch` is
+    /// the current layout epoch, i.e. the reader already has it.
+    void encode_snapshot(std::string& out, uint64_t known_epoch, uint64_t timestamp_ms) const;
+
+    /// Bumped whenever a series or metric is added or removed.
+    [[nodiscard]] uint64_t layout_epoch() const { return layout_epoch_.load(std::memory_order_relaxed); }
+
+    /// Layout epoch at which `name` last gained or lost a series; 0 if it
+    /// is not registered. Unchanged means its series are the same objects.
+    [[nodiscard]] uint64_t metric_epoch(const std::string& name) const;
+
+    /// Calls fn(name, series) for every series in registration order, under
+    /// the shared lock and without copying anything.
+    template <typename Fn>
+    void visit(Fn&& fn) const {
+        std::shared_lock lock(mutex_);
+        for (const auto& name : order_) {
+            auto it = metrics_.find(name);
+            if (it == metrics_.end()) continue;
+            for (const auto& s : it->second.series) {
+                if (s.active) fn(name, s);
+            }
+        }
+    }
+
+    /// Calls fn(series) for every active series of `name`, under the shared lock.
+    template <typename Fn>
+    void visit_metric(const std::string& name, Fn&& fn) const {
+        std::shared_lock lock(mutex_);
+        auto it = metrics_.find(name);
+        if (it == metrics_.end()) return;
+        for (const auto& s : it->second.series) {
+            if (s.active) fn(s);
+        }
+    }
+
 private:
+    MetricSeries* find_series(const std::string& name, const std::string& labels) const;
     MetricSeries* find_or_create_series(const std::string& name, const std::string& labels);
+    MetricSeries* resolve(const std::string& name, const std::string& labels, MetricType type);
+    MetricSeries& claim_series(MetricEntry& entry, const std::string& name,
+                               std::string_view labels, double value);
+    template <typename Entries>
+    void replace_all(const std::string& name, const Entries& entries);
 
     mutable std::shared_mutex mutex_;
     std::vector<std::string> order_;
     std::unordered_map<std::string, MetricEntry> metrics_;
+    uint32_t next_series_id_ = 0;
+    uint32_t replace_pass_   = 0;
+
+    // Set under the unique lock whenever a series or metric is added or removed.
+    mutable std::atomic<bool>            layout_dirty_{true};
+    std::atomic<uint64_t>                layout_epoch_{1};
+    mutable std::mutex                   cache_mutex_;
+    mutable std::shared_ptr<std::string> exposition_;
+    mutable uint64_t                     exposition_version_ = 0;
 };
 
 }
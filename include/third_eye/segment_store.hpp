@@ -0,0 +1,108 @@
+#pragma once
+
+#include "timeseries.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace third_eye {
+
+class Registry;
+
+
+/// Persistent metric history in append-only, memory-mapped segment files.
+///
+/// A segment is a fixed-size file, <seq>.seg: a 4 KiB header followed by
+/// fixed-size blocks of checksummed records. Each evaluation pass appends
+/// one samples record holding the values that changed since the previous
+/// pass. Series seen for the first time in a segment get a series record
+/// (name and labels) first. The first samples record of every block is a
+/// keyframe with every live series, so a block can be decoded on its own.
+///
+/// Each segment has an index of its series and block time ranges. The index
+/// is kept in memory and written next to the segment as <seq>.idx when the
+/// segment is sealed. Range queries use it to pick the blocks that overlap
+/// the window and decode only those, straight from the mapping. When the
+/// total size passes the retention limit, the oldest segment is deleted.
+///
+/// On startup the newest segment is rescanned and cut back to its last
+/// record with a valid checksum, so a crash loses at most the pass being
+/// written.
+class SegmentStore {
+public:
+    struct Options {
+        std::filesystem::path dir;
+        size_t   block_bytes        = 1 << 20;
+        uint32_t blocks_per_segment = 32;
+        uint64_t max_bytes          = 512ULL << 20;   // Retention, over all segments
+    };
+
+    /// Opens (or creates) the store in options.dir and recovers the newest
+    /// segment. Throws std::runtime_error if the directory is unusable.
+    explicit SegmentStore(Options options);
+    ~SegmentStore();
+
+    SegmentStore(const SegmentStore&) = delete;
+    SegmentStore& operator=(const SegmentStore&) = delete;
+
+    /// Appends the current value of every registry series, stamped `ts_ms`.
+    /// Returns false if the pass could not be stored: it does not fit in one
+    /// block, or a new segment could not be created.
+    bool record(const Registry& registry, int64_t ts_ms);
+
+    /// Same contract as TimeSeriesStore::query, always from raw samples.
+    [[nodiscard]] std::vector<TimeSeriesStore::SeriesData> query(const std::string& metric, int64_t start_ms,
+                                                                 int64_t end_ms, int64_t step_ms,
+                                                                 Aggregation agg = Aggregation::Last) const;
+
+    [[nodiscard]] size_t segment_count() const;
+    [[nodiscard]] uint64_t disk_bytes() const;
+
+private:
+    struct Segment;
+
+    static constexpr uint32_t NO_REF = UINT32_MAX;
+
+    /// Writer-side state of one registry series.
+    struct Known {
+        std::string name;
+        std::string labels;
+        uint32_t    ref       = NO_REF;   // Series number in the active segment
+        uint64_t    last_bits = 0;        // Last value written, as bits
+        uint64_t    seen      = 0;        // Last pass that saw it in the registry
+        bool        alive     = false;    // Written to the active segment and not removed
+    };
+
+    struct Current {
+        uint32_t id;
+        uint64_t bits;
+    };
+
+    void   open_existing();
+    bool   start_segment();
+    void   seal(Segment& seg);
+    void   enforce_retention();
+    size_t encode(int64_t ts_ms, bool keyframe);
+    void   commit(int64_t ts_ms);
+
+    Options options_;
+    mutable std::shared_mutex mutex_;
+    std::vector<std::unique_ptr<Segment>> segments_;   // Oldest first; back() is written to
+    uint64_t next_seq_ = 1;
+
+    // Writer state, only touched by record().
+    std::unordered_map<uint32_t, Known> known_;        // Registry series id -> state
+    std::vector<Current> current_;                     // This pass's values
+    std::vector<uint32_t> new_ids_;                    // Series defined by the pending records
+    std::vector<uint32_t> removed_refs_;               // Series gone since the last pass
+    std::string scratch_;                              // Encoded records of this pass
+    uint64_t cycle_ = 0;
+};
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace third_eye::snapshot {
+
+
+/// Binary snapshot served by GET /api/snapshot.bin, version 1.
+///
+///     magic    "TTES"
+///     u8       version (1)
+///     u8       flags (bit 0: name table present)
+///     varint   layout epoch
+///     varint   timestamp, Unix milliseconds
+///     [names]  varint count, then per series:
+///                varint id, u8 type (0 gauge, 1 counter),
+///                varint length + metric name, varint length + labels
+///     values   varint count, then per series: varint id, f64 little-endian
+///
+/// Series ids are stable for as long as the registry layout (its epoch)
+/// does not change. A client that passes ?epoch=<n> matching the current
+/// epoch gets no name table and maps ids with the one it already holds.
+/// Varints are unsigned LEB128. This header has no other dependency, so
+/// pollers can vendor it as-is.
+
+inline constexpr char    MAGIC[4] = {'T', 'T', 'E', 'S'};
+inline constexpr uint8_t VERSION  = 1;
+inline constexpr uint8_t FLAG_NAMES = 0x01;
+
+enum class SeriesType : uint8_t { Gauge = 0, Counter = 1 };
+
+
+// --- Encoding ----------------------------------------------------------------
+
+inline void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline void put_double(std::string& out, double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    char le[8];
+    for (int i = 0; i < 8; ++i) le[i] = static_cast<char>(bits >> (8 * i));
+    out.append(le, sizeof(le));
+}
+
+inline void put_string(std::string& out, std::string_view s) {
+    put_varint(out, s.size());
+    out.append(s);
+}
+
+
+// --- Decoding ----------------------------------------------------------------
+
+struct SeriesInfo {
+    uint32_t    id;
+    SeriesType  type;
+    std::string name;
+    std::string labels;   // {key="val",...} or empty
+};
+
+struct Snapshot {
+    uint64_t epoch        = 0;
+    uint64_t timestamp_ms = 0;
+    bool     has_names    = false;
+    std::vector<SeriesInfo> names;                     // Only if has_names
+    std::vector<std::pair<uint32_t, double>> values;   // (series id, value)
+};
+
+/// Sequential reader over a snapshot buffer; every get_* returns false
+/// once the input is exhausted or malformed.
+class Reader {
+public:
+    explicit Reader(std::string_view data) : p_(data.data()), end_(data.data() + data.size()) {}
+
+    bool get_u8(uint8_t& v) {
+        if (p_ >= end_) return false;
+        v = static_cast<uint8_t>(*p_++);
+        return true;
+    }
+
+    bool get_varint(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b;
+            if (!get_u8(b)) return false;
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool get_double(double& d) {
+        if (end_ - p_ < 8) return false;
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) bits |= static_cast<uint64_t>(static_cast<uint8_t>(p_[i])) << (8 * i);
+        std::memcpy(&d, &bits, sizeof(d));
+        p_ += 8;
+        return true;
+    }
+
+    bool get_string(std::string& s) {
+        uint64_t len;
+        if (!get_varint(len) || static_cast<uint64_t>(end_ - p_) < len) return false;
+        s.assign(p_, static_cast<size_t>(len));
+        p_ += len;
+        return true;
+    }
+
+    bool get_magic() {
+        if (end_ - p_ < 4 || std::memcmp(p_, MAGIC, 4) != 0) return false;
+        p_ += 4;
+        return true;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+/// Decodes a version 1 snapshot into `out`. Returns false on a bad magic,
+/// an unknown version or truncated input.
+inline bool decode(std::string_view data, Snapshot& out) {
+    Reader r(data);
+    uint8_t version, flags;
+    if (!r.get_magic() || !r.get_u8(version) || version != VERSION || !r.get_u8(flags)) return false;
+    if (!r.get_varint(out.epoch) || !r.get_varint(out.timestamp_ms)) return false;
+
+    out.has_names = (flags & FLAG_NAMES) != 0;
+    out.names.clear();
+    out.values.clear();
+
+    uint64_t n;
+    if (out.has_names) {
+        if (!r.get_varint(n)) return false;
+        out.names.reserve(static_cast<size_t>(std::min<uint64_t>(n, data.size())));
+        for (uint64_t i = 0; i < n; ++i) {
+            SeriesInfo s;
+            uint64_t id;
+            uint8_t type;
+            if (!r.get_varint(id) || !r.get_u8(type) || !r.get_string(s.name) || !r.get_string(s.labels))
+                return false;
+            s.id   = static_cast<uint32_t>(id);
+            s.type = static_cast<SeriesType>(type);
+            out.names.push_back(std::move(s));
+        }
+    }
+
+    if (!r.get_varint(n)) return false;
+    out.values.reserve(static_cast<size_t>(std::min<uint64_t>(n, data.size() / 9)));
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t id;
+        double v;
+        if (!r.get_varint(id) || !r.get_double(v)) return false;
+        out.values.emplace_back(static_cast<uint32_t>(id), v);
+    }
+    return true;
+}
+
+}
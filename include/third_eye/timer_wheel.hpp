@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace third_eye {
+
+
+/// Hashed timing wheel over a fixed tick.
+///
+/// Timers are filed into slot `due % slots`, so scheduling is O(1) and a
+/// tick only inspects the timers hashed to its own slot; timers more than
+/// one revolution away simply stay put until their tick comes round.
+class TimerWheel {
+public:
+    explicit TimerWheel(uint32_t tick_ms = 1000, size_t slots = 256);
+
+    /// Files timer `id` to fire at absolute tick `due`.
+    void schedule(uint32_t id, uint64_t due);
+
+    /// Appends to `fired` the ids of every timer due at or before `tick` in
+    /// this tick's slot, and removes them. Callers advance one tick at a time.
+    void advance(uint64_t tick, std::vector<uint32_t>& fired);
+
+    [[nodiscard]] uint32_t tick_ms() const { return tick_ms_; }
+
+private:
+    struct Timer {
+        uint32_t id;
+        uint64_t due;
+    };
+
+    uint32_t tick_ms_;
+    std::vector<std::vector<Timer>> slots_;
+};
+
+}
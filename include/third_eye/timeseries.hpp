@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace third_eye {
+
+class Registry;
+
+
+/// How samples that fall into one query step are combined.
+enum class Aggregation : uint8_t { Last, Avg, Min, Max };
+
+/// "last", "avg", "min", "max" to Aggregation; false for anything else.
+bool parse_aggregation(std::string_view name, Aggregation& out);
+
+
+/// Fixed-memory, in-process history of every registry series.
+///
+/// Each series owns a ring of fixed-size chunks. Inside a chunk, timestamps
+/// are delta-of-delta encoded and values XOR-compressed against the previous
+/// sample (the Gorilla scheme), so a steady 1 s series costs a few bits to a
+/// few bytes per sample. Once a series' ring is full its oldest chunk is
+/// overwritten. Range queries skip chunks outside the window and only decode
+/// the ones that overlap it.
+///
+/// Every sample is also folded, as it is recorded, into rollup tiers of
+/// 10 s, 1 min and 10 min buckets holding min, max, sum, count and last.
+/// The tiers are rings too, so they reach further back than the raw chunks:
+/// by default 1 hour, 12 hours and 7 days. A query with a step uses the
+/// coarsest tier whose bucket fits in one step.
+class TimeSeriesStore {
+public:
+    static constexpr size_t CHUNK_BYTES = 1024;
+
+    static constexpr size_t  TIER_COUNT = 3;
+    static constexpr int64_t TIER_WIDTH_MS[TIER_COUNT] = {10 * 1000, 60 * 1000, 600 * 1000};
+
+    struct Options {
+        // A noisy gauge costs ~9 bytes a sample, ~110 per chunk: 128 chunks
+        // keep about 4 hours of raw 1 s samples, a steady series far more.
+        size_t  chunks_per_series = 128;                 // ~133 KiB of raw samples per series
+        size_t  max_series        = 4096;
+        // Bounds the worst case, every series with full rings (~231 KiB
+        // each with the defaults), by lowering max_series to fit: ~1100.
+        size_t  max_bytes         = 256u << 20;
+        int64_t stale_after_ms    = 6LL * 3600 * 1000;   // Drop series not updated for this long
+        size_t  tier_buckets[TIER_COUNT] = {360, 720, 1008};   // 48 bytes each: ~98 KiB per series
+        std::unordered_set<std::string> skip_metrics;            // Families never recorded
+    };
+
+    struct Point {
+        int64_t ts_ms;
+        double  value;
+    };
+
+    struct SeriesData {
+        std::string        labels;
+        std::vector<Point> points;
+    };
+
+    /// Turns one series' samples, fed in time order, into query points: raw
+    /// samples in [start_ms, end_ms], or with step_ms > 0 one point per step
+    /// boundary t combining the samples in (t - step_ms, t].
+    class Downsampler {
+    public:
+        Downsampler(int64_t start_ms, int64_t end_ms, int64_t step_ms, Aggregation agg = Aggregation::Last)
+            : start_(start_ms), end_(end_ms), step_(step_ms)
+            // With a step, a sample just before `start` can still fill the first point.
+            , from_(step_ms > 0 ? start_ms - step_ms + 1 : start_ms)
+            , agg_(agg) {}
+
+        /// Earliest timestamp that can contribute a point.
+        [[nodiscard]] int64_t from() const { return from_; }
+
+        /// Feeds one sample; false once `ts` is past the end of the range.
+        bool add(std::vector<Point>& out, int64_t ts, double v) {
+            return add(out, ts, v, v, v, 1, v);
+        }
+
+        /// Feeds `count` samples already combined, as a rollup bucket ending at `ts`.
+        bool add(std::vector<Point>& out, int64_t ts, double min, double max, double sum,
+                 uint32_t count, double last) {
+            if (ts > end_) return false;
+            if (ts < from_) return true;
+            if (step_ <= 0) {
+                out.push_back({ts, last});
+                return true;
+            }
+            // Boundary t = start + b*step with ts in (t - step, t].
+            int64_t b = (ts <= start_) ? 0 : (ts - start_ + step_ - 1) / step_;
+            int64_t t = start_ + b * step_;
+            if (t > end_) return false;
+            if (b != last_bucket_) {
+                out.push_back({t, 0.0});
+                min_ = min;
+                max_ = max;
+                sum_ = sum;
+                count_ = count;
+                last_bucket_ = b;
+            } else {
+                min_ = std::min(min_, min);
+                max_ = std::max(max_, max);
+                sum_ += sum;
+                count_ += count;
+            }
+            switch (agg_) {
+                case Aggregation::Avg: out.back().value = sum_ / count_; break;
+                case Aggregation::Min: out.back().value = min_; break;
+                case Aggregation::Max: out.back().value = max_; break;
+                default:               out.back().value = last; break;
+            }
+            return true;
+        }
+
+    private:
+        int64_t start_, end_, step_, from_;
+        Aggregation agg_;
+        int64_t last_bucket_ = -1;
+        double   min_ = 0.0, max_ = 0.0, sum_ = 0.0;
+        uint64_t count_ = 0;
+    };
+
+    TimeSeriesStore();
+    explicit TimeSeriesStore(Options options);
+    ~TimeSeriesStore();
+
+    /// Appends the current value of every registry series, stamped `ts_ms`.
+    /// When max_series is reached, series gone from the registry make room
+    /// for new ones, oldest first; a new series that still does not fit is
+    /// not recorded. Returns how many series were left out that way.
+    size_t record(const Registry& registry, int64_t ts_ms);
+
+    /// Samples of every series named `metric` in [start_ms, end_ms].
+    /// With step_ms > 0 there is one point per step boundary t combining the
+    /// samples in (t - step_ms, t] by `agg`; with step_ms == 0, raw samples.
+    [[nodiscard]] std::vector<SeriesData> query(const std::string& metric, int64_t start_ms,
+                                                int64_t end_ms, int64_t step_ms,
+                                                Aggregation agg = Aggregation::Last) const;
+
+    /// Bucket width of the tier a query with this step reads, or 0 for raw samples.
+    [[nodiscard]] static int64_t resolution_for(int64_t step_ms);
+
+    /// Oldest timestamp a query with this step can still see, as of the last
+    /// record() call; INT64_MAX before the first one.
+    [[nodiscard]] int64_t retained_since(int64_t step_ms) const;
+
+    [[nodiscard]] size_t series_count() const;
+    [[nodiscard]] size_t memory_bytes() const;
+
+private:
+    struct Chunk;
+    struct Bucket;
+    struct Series;
+
+    void release(size_t slot);
+    bool evict_gone();
+
+    Options options_;
+    mutable std::shared_mutex mutex_;
+    std::vector<std::unique_ptr<Series>> slots_;   // nullptr = free
+    // Registry series id -> slot. A map, not a vector: ids are never reused,
+    // so with churning label sets they grow without bound.
+    std::unordered_map<uint32_t, uint32_t> slot_of_id_;
+    std::vector<uint32_t> free_slots_;
+    size_t   live_series_  = 0;
+    size_t   chunk_count_  = 0;
+    size_t   bucket_count_ = 0;
+    int64_t  first_ts_     = INT64_MAX;   // First and last record() calls
+    int64_t  last_ts_      = INT64_MIN;
+    uint64_t record_calls_ = 0;
+};
+
+}
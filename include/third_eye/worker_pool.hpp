@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace third_eye {
+
+
+/// Fixed set of threads draining a FIFO of tasks.
+///
+/// Threads are started once and live until the pool is destroyed, so a
+/// collection cycle costs a queue push and a wake-up per task instead of a
+/// thread spawn. The destructor finishes queued tasks before joining.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    [[nodiscard]] size_t size() const { return threads_.size(); }
+
+private:
+    void worker_loop();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::vector<std::jthread> threads_;
+};
+
+}
@@ -1,10 +1,10 @@
 #include "third_eye/agent.hpp"
 
-#include <iostream>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <numeric>
 
 namespace third_eye {
 
@@ -22,49 +22,62 @@ static std::string timestamp_now() {
     return oss.str();
 }
 
-void Agent::add_log(const std::string& level, const std::string& msg) {
-    auto ts = timestamp_now();
-    if (level == "ERROR") {
-        std::cerr << "[" << ts << "] [" << level << "] " << msg << "\n";
-    } else {
-        std::cout << "[" << ts << "] [" << level << "]  " << msg << "\n";
-    }
-    std::lock_guard lock(log_mutex_);
-    log_buffer_.push_back({ts, level, msg});
-    while (log_buffer_.size() > MAX_LOG_ENTRIES) {
-        log_buffer_.pop_front();
-    }
+void Agent::add_log(LogLevel level, const std::string& msg) {
+    auto ts_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t seq = log_ring_.push(level, ts_ms, msg);
+    if (server_) server_->publish_log(seq, level, ts_ms, msg);
 }
 
-void Agent::log_info(const std::string& msg)  { add_log("INFO", msg); }
+void Agent::log_info(const std::string& msg)  { add_log(LogLevel::Info, msg); }
 void Agent::log_debug(const std::string& msg) {
-    if (config_.log_level == LogLevel::Debug) add_log("DEBUG", msg);
-}
-void Agent::log_error(const std::string& msg) { add_log("ERROR", msg); }
-
-std::vector<LogEntry> Agent::get_logs(const std::string& level_filter, int limit) const {
-    std::lock_guard lock(log_mutex_);
-    std::vector<LogEntry> result;
-    int count = 0;
-    for (auto it = log_buffer_.rbegin(); it != log_buffer_.rend() && count < limit; ++it) {
-        if (level_filter.empty() || it->level == level_filter) {
-            result.push_back(*it);
-            ++count;
-        }
+    bool debug;
+    {
+        std::lock_guard lock(config_mutex_);
+        debug = config_.log_level == LogLevel::Debug;
     }
-    std::reverse(result.begin(), result.end());
-    return result;
+    if (debug) add_log(LogLevel::Debug, msg);
+}
+void Agent::log_error(const std::string& msg) { add_log(LogLevel::Error, msg); }
+
+uint64_t Agent::get_logs(uint64_t since, std::optional<LogLevel> level, size_t limit,
+                         std::vector<LogRecord>& out) const {
+    return log_ring_.read(since, level, limit, out);
+}
+
+Agent::Config Agent::config() const {
+    std::lock_guard lock(config_mutex_);
+    return config_;
 }
 
-void Agent::update_config(int new_interval, const std::string& new_log_level) {
-    if (new_interval > 0) config_.interval = new_interval;
-    if (new_log_level == "debug") {
-        config_.log_level = LogLevel::Debug;
-    } else if (new_log_level == "info") {
-        config_.log_level = LogLevel::Info;
+void Agent::update_config(int64_t new_interval_ms, const std::string& new_log_level) {
+    if (new_interval_ms > 0) new_interval_ms = std::clamp<int64_t>(new_interval_ms, MIN_INTERVAL_MS, MAX_INTERVAL_MS);
+    bool     rescheduled = false;
+    uint32_t interval_ms;
+    LogLevel log_level;
+    {
+        std::lock_guard lock(config_mutex_);
+        if (new_interval_ms > 0 && new_interval_ms != config_.interval_ms) {
+            config_.interval_ms = static_cast<uint32_t>(new_interval_ms);
+            rescheduled = true;
+        }
+        if (new_log_level == "debug") {
+            config_.log_level = LogLevel::Debug;
+        } else if (new_log_level == "info") {
+            config_.log_level = LogLevel::Info;
+        }
+        interval_ms = config_.interval_ms;
+        log_level   = config_.log_level;
     }
-    log_info("Config updated: interval=" + std::to_string(config_.interval) +
-             " log_level=" + (config_.log_level == LogLevel::Debug ? "debug" : "info"));
+    if (rescheduled) {
+        {
+            std::lock_guard lock(cv_mutex_);
+            schedule_dirty_.store(true);
+        }
+        cv_.notify_all();
+    }
+    log_info("Config updated: interval=" + std::to_string(interval_ms) + "ms" +
+             " log_level=" + (log_level == LogLevel::Debug ? "debug" : "info"));
 }
 
 LastError Agent::last_error() const {
@@ -75,15 +88,8 @@ LastError Agent::last_error() const {
 std::string Agent::compute_health() const {
     if (total_errors_.load() > 0.0) return "unhealthy";
 
-    auto snap = registry_.snapshot();
-    for (const auto& m : snap) {
-        if (m.name == "the_third_eye_collect_duration_seconds" && m.labels.empty()) {
-            if (m.value > 2.0) return "degraded";
-        }
-        if (m.name == "the_third_eye_scrape_duration_seconds" && m.labels.empty()) {
-            if (m.value > 1.0) return "degraded";
-        }
-    }
+    if (collect_duration_.value() > 2.0) return "degraded";
+    if (scrape_duration_.value() > 1.0) return "degraded";
     return "healthy";
 }
 
@@ -97,6 +103,16 @@ void Agent::set_processes(std::vector<ProcessInfo> procs) {
     processes_ = std::move(procs);
 }
 
+std::vector<ProcessGroupInfo> Agent::get_groups() const {
+    std::lock_guard lock(process_mutex_);
+    return groups_;
+}
+
+void Agent::set_groups(std::vector<ProcessGroupInfo> groups) {
+    std::lock_guard lock(process_mutex_);
+    groups_ = std::move(groups);
+}
+
 std::vector<AlertEntry> Agent::get_alerts() const {
     std::lock_guard lock(alert_mutex_);
     return {alert_history_.begin(), alert_history_.end()};
@@ -112,131 +128,219 @@ std::vector<AlertEntry> Agent::active_alerts() const {
 }
 
 void Agent::evaluate_alerts() {
-    auto now = std::chrono::steady_clock::now();
-    auto snap = registry_.snapshot();
-
-    double cpu_val = 0, mem_used = 0, mem_total = 0, collect_dur = 0;
-    for (const auto& m : snap) {
-        if (m.labels.empty()) {
-            if (m.name == "the_third_eye_cpu_usage_percent") cpu_val = m.value;
-            else if (m.name == "the_third_eye_memory_used_bytes") mem_used = m.value;
-            else if (m.name == "the_third_eye_memory_total_bytes") mem_total = m.value;
-            else if (m.name == "the_third_eye_collect_duration_seconds") collect_dur = m.value;
-        }
+    uint32_t interval_ms;
+    {
+        std::lock_guard lock(config_mutex_);
+        rule_thresholds_ = {config_.cpu_threshold, config_.memory_threshold,
+                            config_.collect_threshold, config_.core_threshold};
+        interval_ms = config_.interval_ms;
     }
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    alert_rules_.evaluate(registry_, now_ms, *this);
 
-    double mem_pct = (mem_total > 0) ? (mem_used / mem_total * 100.0) : 0;
-
-    auto ts = timestamp_now();
-    std::lock_guard lock(alert_mutex_);
-
-    struct Rule {
-        const char* type;
-        double value;
-        double threshold;
-        std::chrono::steady_clock::time_point& last_fired;
-        std::chrono::seconds cooldown;
-    };
+    if (anomalies_.enabled()) {
+        auto t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::tm tm_buf{};
+#ifdef _WIN32
+        localtime_s(&tm_buf, &t);
+#else
+        localtime_r(&t, &tm_buf);
+#endif
+        anomalies_.set_interval(interval_ms);   // POST /api/config may have changed it
+        anomalies_.update(registry_, tm_buf.tm_hour, *this);
+        anomaly_series_.set(static_cast<double>(anomalies_.series_count()));
+    }
+}
 
-    Rule rules[] = {
-        {"cpu_high",      cpu_val,     config_.cpu_threshold,     last_cpu_alert_,     std::chrono::seconds(30)},
-        {"memory_high",   mem_pct,     config_.memory_threshold,  last_mem_alert_,     std::chrono::seconds(30)},
-        {"collect_slow",  collect_dur, config_.collect_threshold,  last_collect_alert_, std::chrono::seconds(60)},
+bool Agent::load_alert_rules(std::string_view text, std::string& error) {
+    RuleVariables vars = {
+        {"cpu_threshold",     &rule_thresholds_.cpu},
+        {"memory_threshold",  &rule_thresholds_.memory},
+        {"collect_threshold", &rule_thresholds_.collect},
+        {"core_threshold",    &rule_thresholds_.core},
     };
+    return alert_rules_.load(text, vars, error);
+}
 
-    for (auto& rule : rules) {
-        bool firing = rule.value > rule.threshold;
-
-        for (auto& a : alert_history_) {
-            if (a.type == rule.type && a.active && !firing) {
-                a.active = false;
-            }
-        }
+uint64_t Agent::raise_alert(std::string_view rule, std::string_view severity, std::string message,
+                            double value, double threshold) {
+    log_info("Alert: " + message);
 
-        if (firing && (now - rule.last_fired >= rule.cooldown)) {
-            std::ostringstream msg;
-            msg.imbue(std::locale::classic());
-            msg << rule.type << ": " << std::fixed << std::setprecision(1) << rule.value;
-            if (std::string(rule.type) == "collect_slow") {
-                msg << "s > " << rule.threshold << "s";
-            } else {
-                msg << "% > " << rule.threshold << "%";
-            }
+    std::lock_guard lock(alert_mutex_);
+    alert_history_.push_back({
+        std::string(rule), std::string(severity), std::move(message), timestamp_now(),
+        value, threshold, true
+    });
+    if (server_) server_->publish_alert(alert_history_.back(), true);
+
+    while (alert_history_.size() > MAX_ALERT_HISTORY) {
+        alert_history_.pop_front();
+    }
+    return next_alert_id_++;
+}
 
-            alert_history_.push_back({
-                rule.type, "warning", msg.str(), ts,
-                rule.value, rule.threshold, true
-            });
-            rule.last_fired = now;
+void Agent::clear_alert(uint64_t id) {
+    std::lock_guard lock(alert_mutex_);
+    uint64_t oldest = next_alert_id_ - alert_history_.size();
+    if (id < oldest || id >= next_alert_id_) return;   // Already dropped from the history
 
-            while (alert_history_.size() > MAX_ALERT_HISTORY) {
-                alert_history_.pop_front();
-            }
+    AlertEntry& a = alert_history_[id - oldest];
+    if (!a.active) return;
+    a.active = false;
+    if (server_) server_->publish_alert(a, false);
+}
 
-            log_info("Alert: " + msg.str());
-        }
+void Agent::update_thresholds(double cpu, double mem, double collect, double core) {
+    cpu     = std::clamp(cpu, 10.0, 100.0);
+    mem     = std::clamp(mem, 10.0, 100.0);
+    collect = std::clamp(collect, 0.5, 30.0);
+    core    = std::clamp(core, 10.0, 100.0);
+    {
+        std::lock_guard lock(config_mutex_);
+        config_.cpu_threshold     = cpu;
+        config_.memory_threshold  = mem;
+        config_.collect_threshold = collect;
+        config_.core_threshold    = core;
     }
+    log_info("Thresholds updated: cpu=" + std::to_string(cpu)
+           + " mem=" + std::to_string(mem)
+           + " collect=" + std::to_string(collect)
+           + " core=" + std::to_string(core));
+}
+
+/// Baselines follow roughly the last 10 minutes (the detector's default
+/// window); seasonal ones, the same hour over the last week.
+static AnomalyDetector::Options anomaly_options(const Agent::Config& config) {
+    AnomalyDetector::Options opts;
+    opts.metrics     = config.anomaly_metrics;
+    opts.z           = config.anomaly_z;
+    opts.seasonal    = config.anomaly_seasonal;
+    opts.interval_ms = config.interval_ms;
+    return opts;
 }
 
-void Agent::update_thresholds(double cpu, double mem, double collect) {
-    config_.cpu_threshold     = std::clamp(cpu, 10.0, 100.0);
-    config_.memory_threshold  = std::clamp(mem, 10.0, 100.0);
-    config_.collect_threshold = std::clamp(collect, 0.5, 30.0);
-    log_info("Thresholds updated: cpu=" + std::to_string(config_.cpu_threshold)
-           + " mem=" + std::to_string(config_.memory_threshold)
-           + " collect=" + std::to_string(config_.collect_threshold));
+/// With --all-processes the per-process families alone can run to
+/// thousands of short-lived series, more than the history holds, so they
+/// are left out of it; the top-N series of the default mode are kept.
+static TimeSeriesStore::Options history_options(const Agent::Config& config) {
+    TimeSeriesStore::Options opts;
+    if (config.export_all_processes) {
+        opts.skip_metrics = {
+            "the_third_eye_process_cpu_percent",    "the_third_eye_process_memory_bytes",
+            "the_third_eye_process_threads",        "the_third_eye_process_handles",
+            "the_third_eye_process_io_read_bytes_per_second",
+            "the_third_eye_process_io_write_bytes_per_second",
+            "the_third_eye_process_major_faults_per_second",
+        };
+    }
+    return opts;
 }
 
 Agent::Agent(Config config)
     : config_(config)
-    , start_time_(std::chrono::steady_clock::now()) {}
+    , rule_thresholds_{config.cpu_threshold, config.memory_threshold, config.collect_threshold, config.core_threshold}
+    , history_(history_options(config_))
+    , start_time_(std::chrono::steady_clock::now())
+    , anomalies_(anomaly_options(config_)) {
+    register_agent_metrics();
+    std::string error;
+    load_alert_rules(default_alert_rules(), error);
+}
 
 Agent::~Agent() { stop(); }
 
 void Agent::add_collector(std::unique_ptr<Collector> collector) {
     log_debug("Registered collector: " + collector->name());
+    std::string label = R"({collector=")" + collector->name() + R"("})";
+    auto& slot = collector_slots_.emplace_back();
+    auto override_it = config_.collector_intervals_ms.find(collector->name());
+    slot.interval_ms = std::clamp<uint32_t>(override_it != config_.collector_intervals_ms.end()
+                                                ? override_it->second
+                                                : collector->default_interval_ms(),
+                                            MIN_COLLECTOR_INTERVAL_MS, MAX_COLLECTOR_INTERVAL_MS);
+    slot.duration = registry_.gauge_handle("the_third_eye_collector_duration_seconds", label);
+    slot.errors   = registry_.counter_handle("the_third_eye_collect_errors_total", label);
     collectors_.push_back(std::move(collector));
 }
 
 void Agent::register_agent_metrics() {
-    registry_.register_metric("the_third_eye_collect_duration_seconds",
-                              MetricType::Gauge, "Total duration of a collection cycle in seconds.");
+    collect_duration_ = registry_.register_gauge("the_third_eye_collect_duration_seconds",
+                                                 "Duration of the slowest collector's last run in seconds.");
     registry_.register_metric("the_third_eye_collector_duration_seconds",
                               MetricType::Gauge, "Duration of a single collector in seconds.");
     registry_.register_metric("the_third_eye_collect_errors_total",
                               MetricType::Counter, "Total number of collection errors per collector.");
-    registry_.register_metric("the_third_eye_agent_uptime_seconds",
-                              MetricType::Gauge, "Agent uptime in seconds.");
-    registry_.register_metric("the_third_eye_scrape_duration_seconds",
-                              MetricType::Gauge, "Duration of the last /metrics scrape generation in seconds.");
+    agent_uptime_ = registry_.register_gauge("the_third_eye_agent_uptime_seconds",
+                                             "Agent uptime in seconds.");
+    scrape_duration_ = registry_.register_gauge("the_third_eye_scrape_duration_seconds",
+                                                "Duration of the last /metrics scrape generation in seconds.");
     registry_.register_metric("the_third_eye_http_requests_total",
                               MetricType::Counter, "Total HTTP requests received.");
+    history_bytes_ = registry_.register_gauge("the_third_eye_history_bytes",
+                                              "Memory held by the in-process metric history in bytes.");
+    anomaly_series_ = registry_.register_gauge("the_third_eye_anomaly_series",
+                                               "Series watched by the anomaly detector.");
+    history_disk_bytes_ = registry_.register_gauge("the_third_eye_history_disk_bytes",
+                                                   "Disk space held by the persistent metric history in bytes.");
+    history_dropped_ = registry_.register_counter("the_third_eye_history_dropped_samples_total",
+                                                  "Samples left out of the in-memory history because it was full, one per series per pass.");
+    missed_ticks_ = registry_.register_counter("the_third_eye_scheduler_missed_ticks_total",
+                                               "Scheduler ticks whose whole slot had passed before the loop woke.");
+    late_ticks_   = registry_.register_counter("the_third_eye_scheduler_late_ticks_total",
+                                               "Scheduler wake-ups more than 10 ms (or a quarter tick) past their deadline.");
+    tick_lag_     = registry_.register_gauge("the_third_eye_scheduler_tick_lag_seconds",
+                                             "How far past its deadline the last scheduler tick woke, in seconds.");
 }
 
 void Agent::run() {
     log_info("The Third Eye agent v" THIRD_EYE_VERSION " starting");
     log_info("  Port:     " + std::to_string(config_.port));
-    log_info("  Interval: " + std::to_string(config_.interval) + "s");
+    log_info("  Interval: " + std::to_string(config_.interval_ms) + "ms");
     log_info("  Top N:    " + std::to_string(config_.top_n));
     log_info("  Log level: " + std::string(config_.log_level == LogLevel::Debug ? "debug" : "info"));
     log_info("  Collectors: " + std::to_string(collectors_.size()));
+    log_info("  Alert rules: " + std::to_string(alert_rules_.size()) +
+             (config_.rules_path.empty() ? " (built-in)" : " from " + config_.rules_path));
+    for (const auto& [name, ms] : collector_intervals()) {
+        log_info("    " + name + " every " + std::to_string(ms) + "ms");
+    }
 
-    register_agent_metrics();
+    if (!config_.data_dir.empty()) {
+        try {
+            SegmentStore::Options opts;
+            opts.dir       = config_.data_dir;
+            opts.max_bytes = config_.data_retention_bytes;
+            disk_history_ = std::make_unique<SegmentStore>(std::move(opts));
+            log_info("  Data dir: " + config_.data_dir + " (" +
+                     std::to_string(disk_history_->segment_count()) + " segments)");
+        } catch (const std::exception& e) {
+            log_error(std::string("Persistent history disabled: ") + e.what());
+        }
+    }
 
     server_ = std::make_unique<HttpServer>(config_.port, [this]() {
+        uint64_t generation = collect_generation_.load(std::memory_order_acquire);
+        {
+            std::lock_guard lock(scrape_mutex_);
+            if (scraped_ && scrape_generation_ == generation) return registry_.last_exposition();
+        }
+
         auto scrape_start = std::chrono::steady_clock::now();
 
         auto agent_elapsed = std::chrono::steady_clock::now() - start_time_;
-        registry_.gauge_set("the_third_eye_agent_uptime_seconds",
-                            std::chrono::duration<double>(agent_elapsed).count());
+        agent_uptime_.set(std::chrono::duration<double>(agent_elapsed).count());
 
-        std::string body = registry_.serialize();
+        auto exposition = registry_.exposition();
 
         auto scrape_s = std::chrono::duration<double>(
             std::chrono::steady_clock::now() - scrape_start).count();
-        registry_.gauge_set("the_third_eye_scrape_duration_seconds", scrape_s);
+        scrape_duration_.set(scrape_s);
 
-        return body;
+        std::lock_guard lock(scrape_mutex_);
+        scraped_           = true;
+        scrape_generation_ = generation;
+        return exposition;
     }, &registry_, this);
 
     try {
@@ -247,20 +351,16 @@ void Agent::run() {
         return;
     }
 
-    running_.store(true);
-    collect_all();
+    // One worker per collector: a collector is never queued twice, so a
+    // stuck one can only ever hold its own worker.
+    pool_ = std::make_unique<WorkerPool>(std::clamp<size_t>(collectors_.size(), 1, 8));
 
-    while (running_.load()) {
-        std::unique_lock lock(cv_mutex_);
-        cv_.wait_for(lock, std::chrono::seconds(config_.interval), [this] {
-            return !running_.load();
-        });
-        if (!running_.load()) break;
-        collect_all();
-    }
+    running_.store(true);
+    schedule_loop();
 
     log_info("Shutting down...");
     if (server_) server_->stop();
+    pool_.reset();
     log_info("The Third Eye agent stopped.");
 }
 
@@ -271,48 +371,221 @@ void Agent::stop() {
     }
 }
 
-void Agent::collect_all() {
-    log_debug("Starting metric collection cycle");
-    auto cycle_start = std::chrono::steady_clock::now();
+void Agent::record_error(const std::string& collector, const std::string& message) {
+    total_errors_.fetch_add(1.0);
+    std::lock_guard lock(error_mutex_);
+    last_error_ = { collector, timestamp_now(), message };
+}
 
-    for (auto& collector : collectors_) {
-        auto col_start = std::chrono::steady_clock::now();
-        std::string label = R"({collector=")" + collector->name() + R"("})";
+void Agent::run_collector(size_t index) {
+    auto& collector = collectors_[index];
+    auto& slot      = collector_slots_[index];
 
-        try {
-            collector->collect(registry_);
-            double col_s = std::chrono::duration<double>(
-                std::chrono::steady_clock::now() - col_start).count();
-            registry_.gauge_set("the_third_eye_collector_duration_seconds", label, col_s);
-            log_debug("  Collector [" + collector->name() + "] OK");
-        } catch (const std::exception& e) {
-            std::string err_msg = e.what();
-            log_error("Collector [" + collector->name() + "] failed: " + err_msg);
-            registry_.counter_inc("the_third_eye_collect_errors_total", label, 1.0);
-            total_errors_.store(total_errors_.load() + 1.0);
-            {
-                std::lock_guard lock(error_mutex_);
-                last_error_ = { collector->name(), timestamp_now(), err_msg };
-            }
-        } catch (...) {
-            log_error("Collector [" + collector->name() + "] failed with unknown error");
-            registry_.counter_inc("the_third_eye_collect_errors_total", label, 1.0);
-            total_errors_.store(total_errors_.load() + 1.0);
-            {
-                std::lock_guard lock(error_mutex_);
-                last_error_ = { collector->name(), timestamp_now(), "unknown error" };
+    try {
+        collector->collect(registry_);
+        log_debug("  Collector [" + collector->name() + "] OK");
+    } catch (const std::exception& e) {
+        std::string err_msg = e.what();
+        log_error("Collector [" + collector->name() + "] failed: " + err_msg);
+        slot.errors.inc();
+        record_error(collector->name(), err_msg);
+    } catch (...) {
+        log_error("Collector [" + collector->name() + "] failed with unknown error");
+        slot.errors.inc();
+        record_error(collector->name(), "unknown error");
+    }
+
+    double col_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - slot.started).count();
+    slot.duration.set(col_s);
+    if (slot.overrun.exchange(false)) {
+        log_info("Collector [" + collector->name() + "] finished late after " +
+                 std::to_string(col_s) + "s");
+    }
+    collect_generation_.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t Agent::interval_ms_of(size_t index) const {
+    if (index == collectors_.size()) {
+        std::lock_guard lock(config_mutex_);
+        return config_.interval_ms;
+    }
+    return collector_slots_[index].interval_ms.load(std::memory_order_relaxed);
+}
+
+uint32_t Agent::schedule_tick_ms() const {
+    // The wheel ticks at the GCD of every period, so each one is a whole
+    // number of ticks; 10 ms is the finest resolution worth waking for.
+    uint32_t tick = 0;
+    for (size_t i = 0; i <= collectors_.size(); ++i) tick = std::gcd(tick, interval_ms_of(i));
+    return std::max<uint32_t>(tick, 10);
+}
+
+void Agent::schedule_loop() {
+    using clock = std::chrono::steady_clock;
+
+    // Timer ids: one per collector, plus EVALUATE for the alert/history pass
+    // on the global interval. EVALUATE sorts last, so at a shared tick it
+    // runs after that tick's collectors have been dispatched.
+    const auto EVALUATE = static_cast<uint32_t>(collectors_.size());
+
+    TimerWheel wheel;
+    clock::time_point origin;
+    uint64_t tick = 0;
+    std::vector<clock::time_point> next_due(collectors_.size() + 1);
+    std::vector<uint32_t> fired;
+
+    // Phase offsets: collector i first runs i ticks in, so collectors that
+    // share a period stay on different ticks instead of bunching up.
+    auto now = clock::now();
+    for (size_t i = 0; i < collectors_.size(); ++i) {
+        next_due[i] = now + std::chrono::milliseconds(schedule_tick_ms()) * i;
+    }
+    next_due[EVALUATE] = now;
+    schedule_dirty_.store(true);
+
+    while (running_.load()) {
+        if (schedule_dirty_.exchange(false)) {
+            // Re-file every timer on a fresh wheel; a shortened period takes
+            // effect now rather than after the old one elapses.
+            wheel  = TimerWheel(schedule_tick_ms());
+            origin = clock::now();
+            tick   = 0;
+            auto tick_len = std::chrono::milliseconds(wheel.tick_ms());
+            for (uint32_t id = 0; id <= EVALUATE; ++id) {
+                auto latest = origin + std::chrono::milliseconds(interval_ms_of(id));
+                next_due[id] = std::min(next_due[id], latest);
+                auto ahead   = std::max(next_due[id] - origin, clock::duration::zero());
+                wheel.schedule(id, static_cast<uint64_t>((ahead + tick_len - clock::duration(1)) / tick_len));
             }
         }
+
+        auto when = origin + std::chrono::milliseconds(wheel.tick_ms()) * tick;
+        {
+            std::unique_lock lock(cv_mutex_);
+            cv_.wait_until(lock, when, [this] {
+                return !running_.load() || schedule_dirty_.load();
+            });
+        }
+        if (!running_.load()) break;
+        if (schedule_dirty_.load()) continue;
+
+        // Deadlines are absolute (origin + n * tick), so time spent handling
+        // a tick never shifts the ones after it; lateness is measured, not
+        // accumulated.
+        auto woke     = clock::now();
+        auto tick_len = std::chrono::milliseconds(wheel.tick_ms());
+        auto current  = static_cast<uint64_t>((woke - origin) / tick_len);
+        auto lag      = woke - when;
+        tick_lag_.set(std::chrono::duration<double>(lag).count());
+        if (lag > std::min<clock::duration>(tick_len / 4, std::chrono::milliseconds(10))) late_ticks_.inc();
+        if (current > tick) missed_ticks_.inc(static_cast<double>(current - tick));
+
+        // If the loop fell behind, sweep every slot up to the present; a
+        // timer whose tick was passed fires once, not once per missed tick.
+        fired.clear();
+        for (; tick <= current; ++tick) wheel.advance(tick, fired);
+        std::sort(fired.begin(), fired.end());
+
+        for (uint32_t id : fired) {
+            uint64_t period = std::max<uint64_t>(interval_ms_of(id) / wheel.tick_ms(), 1);
+            wheel.schedule(id, tick - 1 + period);
+            next_due[id] = origin + tick_len * (tick - 1 + period);
+
+            if (id == EVALUATE) evaluate_cycle();
+            else                dispatch(id);
+        }
+        check_deadlines();
     }
+}
 
-    double cycle_s = std::chrono::duration<double>(
-        std::chrono::steady_clock::now() - cycle_start).count();
-    registry_.gauge_set("the_third_eye_collect_duration_seconds", cycle_s);
+void Agent::dispatch(size_t index) {
+    auto& slot = collector_slots_[index];
+    if (slot.busy.exchange(true)) {
+        log_debug("  Collector [" + collectors_[index]->name() + "] still running, skipped");
+        return;
+    }
+    slot.started = std::chrono::steady_clock::now();
+    slot.overrun.store(false);
+    pool_->submit([this, index] {
+        run_collector(index);
+        collector_slots_[index].busy.store(false);
+    });
+}
+
+void Agent::check_deadlines() {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < collectors_.size(); ++i) {
+        auto& slot = collector_slots_[i];
+        if (!slot.busy.load()) continue;
+
+        // A run may not outlive its own period either, or it would start
+        // eating the next one.
+        double deadline_s = std::min(config_.collector_deadline, interval_ms_of(i) / 1000.0);
+        double elapsed    = std::chrono::duration<double>(now - slot.started).count();
+        if (elapsed < deadline_s || slot.overrun.exchange(true)) continue;
+
+        const auto& name = collectors_[i]->name();
+        log_error("Collector [" + name + "] exceeded its " + std::to_string(deadline_s) + "s deadline");
+        slot.duration.set(elapsed);
+        slot.errors.inc();
+        record_error(name, "deadline exceeded");
+    }
+}
+
+void Agent::evaluate_cycle() {
+    auto cycle_start = std::chrono::steady_clock::now();
+
+    double slowest = 0.0;
+    for (const auto& slot : collector_slots_) slowest = std::max(slowest, slot.duration.value());
+    collect_duration_.set(slowest);
+
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (size_t dropped = history_.record(registry_, now_ms)) {
+        history_dropped_.inc(static_cast<double>(dropped));
+    }
+    history_bytes_.set(static_cast<double>(history_.memory_bytes()));
+    if (disk_history_) {
+        bool ok = disk_history_->record(registry_, now_ms);
+        if (!ok && !disk_write_failed_) log_error("Failed to write metric history to " + config_.data_dir);
+        disk_write_failed_ = !ok;
+        history_disk_bytes_.set(static_cast<double>(disk_history_->disk_bytes()));
+    }
 
     evaluate_alerts();
+    collect_generation_.fetch_add(1, std::memory_order_release);
+    if (server_) server_->publish_metrics();
 
-    log_debug("Collection cycle completed in " +
+    double cycle_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - cycle_start).count();
+    log_debug("Evaluation cycle completed in " +
               std::to_string(static_cast<int>(cycle_s * 1e6)) + " us");
 }
 
+std::vector<std::pair<std::string, uint32_t>> Agent::collector_intervals() const {
+    std::vector<std::pair<std::string, uint32_t>> result;
+    result.reserve(collectors_.size());
+    for (size_t i = 0; i < collectors_.size(); ++i) {
+        result.emplace_back(collectors_[i]->name(), interval_ms_of(i));
+    }
+    return result;
+}
+
+bool Agent::set_collector_interval(const std::string& name, uint32_t interval_ms) {
+    interval_ms = std::clamp<uint32_t>(interval_ms, MIN_COLLECTOR_INTERVAL_MS, MAX_COLLECTOR_INTERVAL_MS);
+    for (size_t i = 0; i < collectors_.size(); ++i) {
+        if (collectors_[i]->name() != name) continue;
+        collector_slots_[i].interval_ms.store(interval_ms);
+        {
+            std::lock_guard lock(cv_mutex_);
+            schedule_dirty_.store(true);
+        }
+        cv_.notify_all();
+        log_info("Collector [" + name + "] interval set to " + std::to_string(interval_ms) + "ms");
+        return true;
+    }
+    return false;
+}
+
 }
@@ -0,0 +1,677 @@
+#include "third_eye/alert_rules.hpp"
+#include "third_eye/duration.hpp"
+#include "third_eye/registry.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <unordered_map>
+
+namespace third_eye {
+
+namespace {
+
+constexpr std::string_view DEFAULT_RULES = R"(# Built-in rules; the same as passing this file to --rules.
+alert:    cpu_high
+expr:     the_third_eye_cpu_usage_percent > $cpu_threshold
+cooldown: 30s
+message:  {name}: {value}% > {threshold}%
+
+alert:    memory_high
+expr:     the_third_eye_memory_used_bytes / the_third_eye_memory_total_bytes * 100 > $memory_threshold
+cooldown: 30s
+message:  {name}: {value}% > {threshold}%
+
+alert:    collect_slow
+expr:     the_third_eye_collect_duration_seconds > $collect_threshold
+cooldown: 60s
+message:  {name}: {value}s > {threshold}s
+
+alert:    cpu_core_saturated
+expr:     the_third_eye_cpu_core_max_percent > $core_threshold
+cooldown: 30s
+message:  {name}: {value}% > {threshold}%
+)";
+
+constexpr double   NO_VALUE  = std::numeric_limits<double>::quiet_NaN();
+constexpr size_t   MAX_STACK = 32;
+constexpr uint32_t NO_DRIVER = UINT32_MAX;
+constexpr int64_t  NEVER     = std::numeric_limits<int64_t>::min();
+
+enum class Op : uint8_t { Const, Var, Load, Max, Min, Sum, Avg, Count, Neg, Add, Sub, Mul, Div };
+enum class Cmp : uint8_t { Gt, Ge, Lt, Le, Eq, Ne };
+
+struct Instr {
+    Op       op;
+    uint32_t arg = 0;     // Var: variable index; Load and aggregations: selector index
+    double   k   = 0.0;   // Const
+};
+
+struct Matcher {
+    std::string key;
+    std::string value;
+    bool        equal;
+};
+
+struct Selector {
+    std::string          metric;
+    std::vector<Matcher> matchers;
+    bool                 rate = false;
+    Op                   op   = Op::Load;   // How the expression reads it
+
+    // Bound series, in registry order, and what this pass read from them.
+    std::vector<const MetricSeries*> series;
+    std::vector<uint32_t>            ids;
+    std::vector<std::string>         labels;
+    std::vector<double>              values;   // Value, or rate() over the last interval
+    std::vector<double>              prev;     // rate(): raw value of the previous pass
+    int64_t                          prev_ms = -1;
+    double                           aggregate = NO_VALUE;   // max() etc. over `values`, once per pass
+    uint64_t                         epoch = UINT64_MAX;     // Registry::metric_epoch() when bound
+};
+
+struct Instance {
+    uint32_t id = 0;                 // Driving series id (0 without a driver)
+    int64_t  pending_since = -1;     // Condition true since; -1 while false
+    int64_t  last_raised   = NEVER;
+    uint64_t alert         = 0;      // Sink id while raised
+    bool     raised        = false;
+};
+
+bool is_ident_start(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':';
+}
+bool is_ident(char c) { return is_ident_start(c) || (c >= '0' && c <= '9'); }
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t' || s.front() == '\r')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+/// Value of `key` in a pre-formatted label set ({k="v",...}); false if absent.
+bool label_value(std::string_view labels, std::string_view key, std::string& out) {
+    size_t pos = 1;
+    while (pos < labels.size()) {
+        size_t eq = labels.find("=\"", pos);
+        if (eq == std::string_view::npos) return false;
+        std::string_view k = labels.substr(pos, eq - pos);
+        out.clear();
+        size_t i = eq + 2;
+        for (; i < labels.size() && labels[i] != '"'; ++i) {
+            if (labels[i] == '\\' && i + 1 < labels.size()) {
+                ++i;
+                out += labels[i] == 'n' ? '\n' : labels[i];
+            } else {
+                out += labels[i];
+            }
+        }
+        if (k == key) return true;
+        pos = i + 2;   // Past the closing quote and the comma
+    }
+    return false;
+}
+
+bool matches(const Selector& sel, const std::string& name, const std::string& labels) {
+    if (name != sel.metric) return false;
+    std::string value;
+    for (const auto& m : sel.matchers) {
+        bool found = label_value(labels, m.key, value);
+        bool equal = m.value.empty() ? !found || value.empty() : found && value == m.value;
+        if (equal != m.equal) return false;
+    }
+    return true;
+}
+
+}
+
+
+struct AlertRules::Rule {
+    std::string name;
+    std::string severity = "warning";
+    std::string message;
+    int64_t     for_ms      = 0;
+    int64_t     cooldown_ms = -1;   // -1: raise once per breach
+
+    std::vector<Selector>      selectors;
+    std::vector<const double*> vars;
+    std::vector<Instr>         lhs, rhs;
+    Cmp         cmp       = Cmp::Gt;
+    const char* cmp_text  = ">";
+    uint32_t    driver    = NO_DRIVER;   // Selector evaluated per series
+
+    std::vector<Instance> instances;
+
+    double run(const std::vector<Instr>& code, size_t inst) const;
+};
+
+
+// --- Compiler ------------------------------------------------------------------
+
+namespace {
+
+/// Recursive-descent compiler for one `expr:` line.
+class ExprCompiler {
+public:
+    ExprCompiler(std::string_view text, const RuleVariables& vars, std::vector<Selector>& selectors,
+                 std::vector<const double*>& bound_vars, uint32_t& driver)
+        : text_(text), vars_(vars), selectors_(selectors), bound_vars_(bound_vars), driver_(driver) {}
+
+    bool compile(std::vector<Instr>& lhs, Cmp& cmp, const char*& cmp_text, std::vector<Instr>& rhs,
+                 std::string& error) {
+        code_ = &lhs;
+        if (!sum()) return fail(error);
+        skip_space();
+        static constexpr struct { const char* text; Cmp cmp; } OPS[] = {
+            {">=", Cmp::Ge}, {"<=", Cmp::Le}, {"==", Cmp::Eq}, {"!=", Cmp::Ne}, {">", Cmp::Gt}, {"<", Cmp::Lt},
+        };
+        bool found = false;
+        for (const auto& op : OPS) {
+            if (text_.substr(pos_).starts_with(op.text)) {
+                cmp      = op.cmp;
+                cmp_text = op.text;
+                pos_    += std::string_view(op.text).size();
+                found    = true;
+                break;
+            }
+        }
+        if (!found) {
+            error_ = "expected a comparison (>, >=, <, <=, ==, !=)";
+            return fail(error);
+        }
+        code_  = &rhs;
+        depth_ = max_depth_ = 0;
+        if (!sum()) return fail(error);
+        skip_space();
+        if (pos_ != text_.size()) {
+            error_ = "unexpected '" + std::string(text_.substr(pos_, 1)) + "'";
+            return fail(error);
+        }
+        return true;
+    }
+
+private:
+    bool fail(std::string& error) {
+        error = error_.empty() ? "malformed expression" : error_;
+        error += " at column " + std::to_string(pos_ + 1);
+        return false;
+    }
+
+    void skip_space() {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t')) ++pos_;
+    }
+
+    bool accept(char c) {
+        skip_space();
+        if (pos_ < text_.size() && text_[pos_] == c) { ++pos_; return true; }
+        return false;
+    }
+
+    std::string_view ident() {
+        skip_space();
+        size_t start = pos_;
+        if (pos_ < text_.size() && is_ident_start(text_[pos_])) {
+            while (pos_ < text_.size() && is_ident(text_[pos_])) ++pos_;
+        }
+        return text_.substr(start, pos_ - start);
+    }
+
+    /// Tracks the stack height the emitted code reaches.
+    bool emit(Instr ins, int stack_change) {
+        code_->push_back(ins);
+        depth_ += stack_change;
+        max_depth_ = std::max(max_depth_, depth_);
+        if (max_depth_ > static_cast<int>(MAX_STACK)) {
+            error_ = "expression too deeply nested";
+            return false;
+        }
+        return true;
+    }
+
+    bool sum() {
+        if (!product()) return false;
+        for (;;) {
+            if (accept('+'))      { if (!product() || !emit({Op::Add}, -1)) return false; }
+            else if (accept('-')) { if (!product() || !emit({Op::Sub}, -1)) return false; }
+            else return true;
+        }
+    }
+
+    bool product() {
+        if (!unary()) return false;
+        for (;;) {
+            if (accept('*'))      { if (!unary() || !emit({Op::Mul}, -1)) return false; }
+            else if (accept('/')) { if (!unary() || !emit({Op::Div}, -1)) return false; }
+            else return true;
+        }
+    }
+
+    bool unary() {
+        if (accept('-')) return unary() && emit({Op::Neg}, 0);
+        return primary();
+    }
+
+    bool primary() {
+        skip_space();
+        if (pos_ >= text_.size()) {
+            error_ = "unexpected end of expression";
+            return false;
+        }
+
+        char c = text_[pos_];
+        if ((c >= '0' && c <= '9') || c == '.') {
+            double v = 0.0;
+            auto [p, ec] = std::from_chars(text_.data() + pos_, text_.data() + text_.size(), v);
+            if (ec != std::errc{}) {
+                error_ = "invalid number";
+                return false;
+            }
+            pos_ = static_cast<size_t>(p - text_.data());
+            return emit({Op::Const, 0, v}, 1);
+        }
+        if (c == '$') {
+            ++pos_;
+            std::string_view name = ident();
+            auto it = std::find_if(vars_.begin(), vars_.end(), [&](const auto& v) { return v.first == name; });
+            if (it == vars_.end()) {
+                error_ = "unknown variable $" + std::string(name);
+                return false;
+            }
+            bound_vars_.push_back(it->second);
+            return emit({Op::Var, static_cast<uint32_t>(bound_vars_.size() - 1)}, 1);
+        }
+        if (accept('(')) {
+            if (!sum()) return false;
+            if (!accept(')')) {
+                error_ = "expected ')'";
+                return false;
+            }
+            return true;
+        }
+
+        std::string_view name = ident();
+        if (name.empty()) {
+            error_ = "unexpected '" + std::string(1, c) + "'";
+            return false;
+        }
+        if (!accept('(')) return selector(name, false, Op::Load);
+
+        static constexpr struct { const char* name; Op op; } FUNCS[] = {
+            {"rate", Op::Load}, {"max", Op::Max}, {"min", Op::Min}, {"sum", Op::Sum},
+            {"avg", Op::Avg}, {"count", Op::Count},
+        };
+        auto fn = std::find_if(std::begin(FUNCS), std::end(FUNCS), [&](const auto& f) { return name == f.name; });
+        if (fn == std::end(FUNCS)) {
+            error_ = "unknown function " + std::string(name) + "()";
+            return false;
+        }
+        // rate() may also sit inside an aggregation: max(rate(x)).
+        bool rate = fn->op == Op::Load;
+        size_t mark = pos_;
+        std::string_view inner = ident();
+        if (!rate && inner == "rate" && accept('(')) {
+            if (!selector(ident(), true, fn->op) || !accept(')')) {
+                if (error_.empty()) error_ = "expected ')'";
+                return false;
+            }
+        } else {
+            pos_ = mark;
+            if (!selector(ident(), rate, fn->op)) return false;
+        }
+        if (!accept(')')) {
+            error_ = "expected ')'";
+            return false;
+        }
+        return true;
+    }
+
+    /// metric{label="value",label!="value"}, loaded by `op`.
+    bool selector(std::string_view metric, bool rate, Op op) {
+        if (metric.empty()) {
+            error_ = "expected a metric name";
+            return false;
+        }
+        Selector sel;
+        sel.metric = metric;
+        sel.rate   = rate;
+        sel.op     = op;
+        if (accept('{') && !accept('}')) {
+            do {
+                Matcher m;
+                m.key = ident();
+                skip_space();
+                if (m.key.empty()) {
+                    error_ = "expected a label name";
+                    return false;
+                }
+                if (text_.substr(pos_).starts_with("!=")) { m.equal = false; pos_ += 2; }
+                else if (accept('='))                    { m.equal = true; }
+                else {
+                    error_ = "expected = or != after label " + m.key;
+                    return false;
+                }
+                if (!accept('"')) {
+                    error_ = "expected a quoted label value";
+                    return false;
+                }
+                for (; pos_ < text_.size() && text_[pos_] != '"'; ++pos_) {
+                    if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) ++pos_;
+                    m.value += text_[pos_];
+                }
+                if (!accept('"')) {
+                    error_ = "unterminated label value";
+                    return false;
+                }
+                sel.matchers.push_back(std::move(m));
+            } while (accept(','));
+            if (!accept('}')) {
+                error_ = "expected '}'";
+                return false;
+            }
+        }
+
+        auto index = static_cast<uint32_t>(selectors_.size());
+        selectors_.push_back(std::move(sel));
+        if (op == Op::Load && driver_ == NO_DRIVER) driver_ = index;
+        return emit({op, index}, 1);
+    }
+
+    std::string_view                text_;
+    size_t                          pos_ = 0;
+    const RuleVariables&            vars_;
+    std::vector<Selector>&          selectors_;
+    std::vector<const double*>&     bound_vars_;
+    uint32_t&                       driver_;
+    std::vector<Instr>*             code_ = nullptr;
+    int                             depth_ = 0;
+    int                             max_depth_ = 0;
+    std::string                     error_;
+};
+
+}
+
+
+// --- AlertRules ----------------------------------------------------------------
+
+std::string_view default_alert_rules() { return DEFAULT_RULES; }
+
+AlertRules::AlertRules() = default;
+AlertRules::~AlertRules() = default;
+AlertRules::AlertRules(AlertRules&&) noexcept = default;
+AlertRules& AlertRules::operator=(AlertRules&&) noexcept = default;
+
+size_t AlertRules::size() const { return rules_.size(); }
+
+bool AlertRules::load(std::string_view text, const RuleVariables& vars, std::string& error) {
+    std::vector<Rule> rules;
+    std::vector<std::string_view> exprs;
+    size_t line_no = 0;
+    auto fail = [&](const std::string& msg) {
+        error = "line " + std::to_string(line_no) + ": " + msg;
+        return false;
+    };
+
+    while (!text.empty()) {
+        ++line_no;
+        auto nl = text.find('\n');
+        std::string_view line = text.substr(0, nl);
+        text = nl == std::string_view::npos ? std::string_view{} : text.substr(nl + 1);
+
+        // '#' at the start of a line or after a blank starts a comment.
+        for (size_t i = 0; i < line.size(); ++i) {
+            if (line[i] == '#' && (i == 0 || line[i - 1] == ' ' || line[i - 1] == '\t')) {
+                line = line.substr(0, i);
+                break;
+            }
+        }
+        line = trim(line);
+        if (line.empty()) continue;
+
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos) return fail("expected 'key: value'");
+        std::string_view key   = trim(line.substr(0, colon));
+        std::string_view value = trim(line.substr(colon + 1));
+
+        if (key == "alert") {
+            if (value.empty() || !std::all_of(value.begin(), value.end(), is_ident))
+                return fail("alert name must be letters, digits and underscores");
+            if (std::any_of(rules.begin(), rules.end(), [&](const Rule& r) { return r.name == value; }))
+                return fail("duplicate alert " + std::string(value));
+            rules.emplace_back().name = value;
+            continue;
+        }
+        if (rules.empty()) return fail("'" + std::string(key) + "' before the first 'alert:'");
+        Rule& rule = rules.back();
+
+        if (key == "expr") {
+            if (!rule.lhs.empty()) return fail("second expr for " + rule.name);
+            std::string why;
+            ExprCompiler compiler(value, vars, rule.selectors, rule.vars, rule.driver);
+            if (!compiler.compile(rule.lhs, rule.cmp, rule.cmp_text, rule.rhs, why)) return fail(why);
+        } else if (key == "for") {
+            if (!parse_duration_ms(value, rule.for_ms)) return fail("invalid duration '" + std::string(value) + "'");
+        } else if (key == "cooldown") {
+            if (!parse_duration_ms(value, rule.cooldown_ms)) return fail("invalid duration '" + std::string(value) + "'");
+        } else if (key == "severity") {
+            rule.severity = value;
+        } else if (key == "message") {
+            rule.message = value;
+        } else {
+            return fail("unknown key '" + std::string(key) + "'");
+        }
+    }
+
+    for (auto& rule : rules) {
+        if (rule.lhs.empty()) {
+            error = "alert " + rule.name + " has no expr";
+            return false;
+        }
+        if (rule.message.empty()) rule.message = std::string("{name}: {value} ") + rule.cmp_text + " {threshold}";
+    }
+
+    rules_       = std::move(rules);
+    bound_epoch_ = UINT64_MAX;
+    return true;
+}
+
+namespace {
+
+/// Rebinds `sel` to the series of its metric, carrying rate() history over
+/// to series that are still there.
+void bind_selector(const Registry& registry, Selector& sel) {
+    std::unordered_map<uint32_t, double> prev;
+    for (size_t k = 0; k < sel.ids.size() && sel.rate; ++k) prev.emplace(sel.ids[k], sel.prev[k]);
+    sel.series.clear();
+    sel.ids.clear();
+    sel.labels.clear();
+
+    registry.visit_metric(sel.metric, [&](const MetricSeries& ms) {
+        if (!matches(sel, sel.metric, ms.labels)) return;
+        sel.series.push_back(&ms);
+        sel.ids.push_back(ms.id);
+        sel.labels.push_back(ms.labels);
+    });
+
+    sel.values.assign(sel.series.size(), NO_VALUE);
+    sel.prev.assign(sel.series.size(), NO_VALUE);
+    for (size_t k = 0; k < sel.ids.size() && sel.rate; ++k) {
+        if (auto it = prev.find(sel.ids[k]); it != prev.end()) sel.prev[k] = it->second;
+    }
+}
+
+}
+
+void AlertRules::bind(const Registry& registry) {
+    // Process top-N churn moves the layout epoch many times a cycle, but
+    // rarely under a metric a rule reads: only selectors whose own metric
+    // changed are rebound.
+    std::unordered_map<uint32_t, Instance> instances;
+    for (auto& rule : rules_) {
+        bool driver_moved = false;
+        for (size_t i = 0; i < rule.selectors.size(); ++i) {
+            auto&    sel   = rule.selectors[i];
+            uint64_t epoch = registry.metric_epoch(sel.metric);
+            if (epoch == sel.epoch) continue;
+            sel.epoch = epoch;
+            bind_selector(registry, sel);
+            driver_moved |= i == rule.driver;
+        }
+        if (!driver_moved && !rule.instances.empty()) continue;
+
+        // Alert state follows the driving series by id.
+        instances.clear();
+        for (auto& in : rule.instances) instances.emplace(in.id, std::move(in));
+        size_t n = rule.driver == NO_DRIVER ? 1 : rule.selectors[rule.driver].ids.size();
+        rule.instances.assign(n, Instance{});
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t id = rule.driver == NO_DRIVER ? 0 : rule.selectors[rule.driver].ids[i];
+            if (auto it = instances.find(id); it != instances.end()) {
+                rule.instances[i] = it->second;
+                instances.erase(it);
+            }
+            rule.instances[i].id = id;
+        }
+        // Alerts of series that are gone resolve with them on this pass.
+        for (auto& [id, in] : instances) {
+            if (in.raised) rule.instances.push_back(std::move(in));
+        }
+    }
+}
+
+double AlertRules::Rule::run(const std::vector<Instr>& code, size_t inst) const {
+    double stack[MAX_STACK];
+    size_t sp = 0;
+
+    for (const auto& ins : code) {
+        switch (ins.op) {
+            case Op::Const: stack[sp++] = ins.k; break;
+            case Op::Var:   stack[sp++] = *vars[ins.arg]; break;
+            case Op::Load: {
+                const auto& v = selectors[ins.arg].values;
+                size_t k = ins.arg == driver ? inst : 0;
+                stack[sp++] = k < v.size() ? v[k] : NO_VALUE;
+                break;
+            }
+            case Op::Max: case Op::Min: case Op::Sum: case Op::Avg: case Op::Count:
+                stack[sp++] = selectors[ins.arg].aggregate;
+                break;
+            case Op::Neg: stack[sp - 1] = -stack[sp - 1]; break;
+            case Op::Add: --sp; stack[sp - 1] += stack[sp]; break;
+            case Op::Sub: --sp; stack[sp - 1] -= stack[sp]; break;
+            case Op::Mul: --sp; stack[sp - 1] *= stack[sp]; break;
+            case Op::Div:
+                --sp;
+                stack[sp - 1] = stack[sp] == 0.0 ? NO_VALUE : stack[sp - 1] / stack[sp];
+                break;
+        }
+    }
+    return sp > 0 ? stack[sp - 1] : NO_VALUE;
+}
+
+void AlertRules::evaluate(const Registry& registry, int64_t now_ms, AlertSink& sink) {
+    if (rules_.empty()) return;
+    if (registry.layout_epoch() != bound_epoch_) {
+        bound_epoch_ = registry.layout_epoch();
+        bind(registry);
+    }
+
+    for (auto& rule : rules_) {
+        for (auto& sel : rule.selectors) {
+            double dt_s = sel.prev_ms >= 0 ? static_cast<double>(now_ms - sel.prev_ms) / 1000.0 : 0.0;
+            for (size_t k = 0; k < sel.series.size(); ++k) {
+                double v = sel.series[k]->current();
+                if (sel.rate) {
+                    sel.values[k] = dt_s > 0.0 ? (v - sel.prev[k]) / dt_s : NO_VALUE;
+                    sel.prev[k]   = v;
+                } else {
+                    sel.values[k] = v;
+                }
+            }
+            sel.prev_ms = now_ms;
+
+            if (sel.op == Op::Load) continue;
+            double acc = NO_VALUE;
+            size_t n = 0;
+            for (double x : sel.values) {
+                if (std::isnan(x)) continue;
+                if (n++ == 0)              acc = x;
+                else if (sel.op == Op::Max) acc = std::max(acc, x);
+                else if (sel.op == Op::Min) acc = std::min(acc, x);
+                else                        acc += x;
+            }
+            if (sel.op == Op::Avg && n > 0) acc /= static_cast<double>(n);
+            if (sel.op == Op::Count)        acc = static_cast<double>(n);
+            sel.aggregate = acc;
+        }
+
+        for (size_t i = 0; i < rule.instances.size(); ++i) {
+            Instance& in = rule.instances[i];
+            bool live = rule.driver == NO_DRIVER || i < rule.selectors[rule.driver].ids.size();
+
+            double value     = live ? rule.run(rule.lhs, i) : NO_VALUE;
+            double threshold = live ? rule.run(rule.rhs, i) : NO_VALUE;
+            bool firing = false;
+            if (!std::isnan(value) && !std::isnan(threshold)) {
+                switch (rule.cmp) {
+                    case Cmp::Gt: firing = value >  threshold; break;
+                    case Cmp::Ge: firing = value >= threshold; break;
+                    case Cmp::Lt: firing = value <  threshold; break;
+                    case Cmp::Le: firing = value <= threshold; break;
+                    case Cmp::Eq: firing = value == threshold; break;
+                    case Cmp::Ne: firing = value != threshold; break;
+                }
+            }
+
+            if (!firing) {
+                in.pending_since = -1;
+                if (in.raised) sink.clear_alert(in.alert);
+                in.raised = false;
+                continue;
+            }
+            if (in.pending_since < 0) in.pending_since = now_ms;
+            if (now_ms - in.pending_since < rule.for_ms) continue;
+
+            bool due = rule.cooldown_ms < 0 ? !in.raised
+                     : in.last_raised == NEVER || now_ms - in.last_raised >= rule.cooldown_ms;
+            if (!due) continue;
+
+            std::string message;
+            char num[32];
+            const std::string_view tmpl = rule.message;
+            for (size_t p = 0; p < tmpl.size();) {
+                auto open = tmpl.find('{', p);
+                auto close = open == std::string_view::npos ? open : tmpl.find('}', open);
+                if (close == std::string_view::npos) {
+                    message += tmpl.substr(p);
+                    break;
+                }
+                message += tmpl.substr(p, open - p);
+                std::string_view field = tmpl.substr(open + 1, close - open - 1);
+                if (field == "name") {
+                    message += rule.name;
+                } else if (field == "value" || field == "threshold") {
+                    std::snprintf(num, sizeof(num), "%.1f", field == "value" ? value : threshold);
+                    message += num;
+                } else if (field == "labels") {
+                    if (rule.driver != NO_DRIVER) message += rule.selectors[rule.driver].labels[i];
+                } else {
+                    message += tmpl.substr(open, close - open + 1);
+                }
+                p = close + 1;
+            }
+
+            // A re-raise replaces the earlier alert rather than piling up beside it.
+            if (in.raised) sink.clear_alert(in.alert);
+            in.alert  = sink.raise_alert(rule.name, rule.severity, std::move(message), value, threshold);
+            in.raised = true;
+            in.last_raised = now_ms;
+        }
+
+        // Instances kept only to resolve their alerts are gone now.
+        if (rule.driver != NO_DRIVER) rule.instances.resize(rule.selectors[rule.driver].ids.size());
+    }
+}
+
+}
@@ -0,0 +1,144 @@
+#include "third_eye/anomaly.hpp"
+#include "third_eye/registry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
+
+namespace third_eye {
+
+namespace {
+
+/// One exponentially weighted mean/variance step (West's incremental form).
+void ewma(float& mean, float& var, double x, double alpha) {
+    double diff = x - mean;
+    double incr = alpha * diff;
+    mean = static_cast<float>(mean + incr);
+    var  = static_cast<float>((1.0 - alpha) * (var + diff * incr));
+}
+
+}
+
+AnomalyDetector::AnomalyDetector(Options options) : options_(std::move(options)) {
+    for (const auto& m : options_.metrics) {
+        if (m == "*") all_ = true;
+        else          names_.insert(m);
+    }
+    options_.streak = std::max<uint32_t>(options_.streak, 1);
+    set_interval(options_.interval_ms);
+}
+
+void AnomalyDetector::set_interval(uint32_t interval_ms) {
+    options_.interval_ms = std::max<uint32_t>(interval_ms, 1);
+    double window   = static_cast<double>(options_.window_ms) / options_.interval_ms;
+    alpha_          = std::clamp(2.0 / (window + 1.0), 1e-6, 1.0);
+    // An hour's baseline spans about a week of that hour.
+    seasonal_alpha_ = std::min(options_.interval_ms / (7.0 * HOUR_MS), 1.0);
+}
+
+bool AnomalyDetector::tracks(const std::string& name) const {
+    return all_ || names_.contains(name);
+}
+
+void AnomalyDetector::bind(const Registry& registry, AlertSink& sink) {
+    std::unordered_map<uint32_t, size_t> old_index;
+    for (size_t i = 0; i < states_.size(); ++i) old_index.emplace(states_[i].id, i);
+
+    std::vector<State>    states;
+    std::vector<HourStat> hours;
+    series_.clear();
+    labels_.clear();
+
+    registry.visit([&](const std::string& name, const MetricSeries& ms) {
+        if (ms.counter || !tracks(name)) return;   // Counters only ever grow
+        series_.push_back(&ms);
+        labels_.push_back(name + ms.labels);
+
+        auto it = old_index.find(ms.id);
+        if (it == old_index.end()) {
+            states.push_back({});
+            states.back().id = ms.id;
+            if (options_.seasonal) hours.resize(hours.size() + HOURS);
+            return;
+        }
+        states.push_back(states_[it->second]);
+        if (options_.seasonal) {
+            auto first = hours_.begin() + static_cast<ptrdiff_t>(it->second * HOURS);
+            hours.insert(hours.end(), first, first + HOURS);
+        }
+        old_index.erase(it);
+    });
+
+    // Series that went away take their alerts with them.
+    for (const auto& [id, index] : old_index) {
+        if (states_[index].anomalous) sink.clear_alert(states_[index].alert);
+    }
+    states_ = std::move(states);
+    hours_  = std::move(hours);
+}
+
+void AnomalyDetector::update(const Registry& registry, int hour, AlertSink& sink) {
+    if (!enabled()) return;
+    if (registry.layout_epoch() != bound_epoch_) {
+        bound_epoch_ = registry.layout_epoch();
+        bind(registry, sink);
+    }
+    hour = std::clamp(hour, 0, static_cast<int>(HOURS) - 1);
+    const double z_raise = options_.z;
+    const double z_clear = options_.z / 2.0;
+
+    for (size_t i = 0; i < states_.size(); ++i) {
+        State& s = states_[i];
+        double x = series_[i]->current();
+        if (!std::isfinite(x)) continue;
+
+        // Baseline: this hour's once it has seen a full hour, else the global one.
+        double mean = s.mean, var = s.var;
+        HourStat* h = options_.seasonal ? &hours_[i * HOURS + static_cast<size_t>(hour)] : nullptr;
+        if (h && h->covered_ms >= HOUR_MS) {
+            mean = h->mean;
+            var  = h->var;
+        }
+
+        bool first = s.samples == 0;
+        if (s.samples >= options_.warmup) {
+            // Floor the deviation so a flat series does not flag rounding noise.
+            double sd = std::max(std::sqrt(std::max(var, 0.0)), 1e-2 * std::max(std::abs(mean), 1e-3));
+            double z  = (x - mean) / sd;
+
+            if (std::abs(z) > z_raise) {
+                if (s.streak < UINT16_MAX) ++s.streak;
+                if (!s.anomalous && s.streak >= options_.streak) {
+                    double bound = mean + (z > 0 ? z_raise : -z_raise) * sd;
+                    char msg[128];
+                    std::snprintf(msg, sizeof(msg), " = %.4g, expected %.4g +/- %.3g (z %.1f)", x, mean, sd, z);
+                    s.alert     = sink.raise_alert("anomaly", "warning", "anomaly: " + labels_[i] + msg, x, bound);
+                    s.anomalous = true;
+                }
+            } else {
+                s.streak = 0;
+                if (s.anomalous && std::abs(z) < z_clear) {
+                    sink.clear_alert(s.alert);
+                    s.anomalous = false;
+                }
+            }
+        }
+        if (s.samples < UINT32_MAX) ++s.samples;
+
+        // Plain running mean and variance until there are 1/alpha samples,
+        // so the first estimates are not dragged towards zero.
+        if (first) s.mean = static_cast<float>(x);
+        else       ewma(s.mean, s.var, x, std::max(alpha_, 1.0 / s.samples));
+        if (h) {
+            // Each sample weighs the time it stands for, so an interval
+            // change does not shift how far back the hour reaches.
+            double covered = static_cast<double>(h->covered_ms) + options_.interval_ms;
+            if (h->covered_ms == 0) h->mean = static_cast<float>(x);
+            else                    ewma(h->mean, h->var, x, std::max(seasonal_alpha_, options_.interval_ms / covered));
+            h->covered_ms = static_cast<uint32_t>(std::min<double>(covered, UINT32_MAX));
+        }
+    }
+}
+
+}
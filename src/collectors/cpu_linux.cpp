@@ -0,0 +1,173 @@
+#include "third_eye/collector.hpp"
+#include "third_eye/registry.hpp"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+
+#include "procfs_linux.hpp"
+
+namespace third_eye {
+
+/// Collects CPU utilization metrics from /proc/stat.
+///
+/// Usage is computed from the delta of the "cpu" lines between consecutive
+/// collection cycles: the aggregate line gives the overall usage and the
+/// user/system/idle/iowait/irq/steal split, each "cpuN" line the usage of
+/// one logical core. Counters of all lines live in one flat array, so a
+/// cycle is a single linear pass whatever the core count. The first call
+/// establishes a baseline.
+class CpuCollector : public Collector {
+public:
+    CpuCollector() : stat_("/proc/stat") {
+        long n = ::sysconf(_SC_NPROCESSORS_CONF);
+        buf_.resize(BYTES_PER_LINE * static_cast<size_t>(n > 0 ? n + 1 : 2) + 512);
+    }
+
+    [[nodiscard]] std::string name() const override { return "cpu"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 250; }
+
+    void collect(Registry& registry) override {
+
+        if (!usage_) {
+            usage_ = registry.register_gauge("the_third_eye_cpu_usage_percent",
+                                             "Current CPU usage as a percentage (0-100).");
+            cores_ = registry.register_gauge("the_third_eye_cpu_cores",
+                                             "Number of logical CPU cores.");
+            core_max_ = registry.register_gauge("the_third_eye_cpu_core_max_percent",
+                                                "Usage of the busiest logical core as a percentage (0-100).");
+            registry.register_metric("the_third_eye_cpu_core_usage_percent", MetricType::Gauge,
+                                     "Usage of one logical core as a percentage (0-100).");
+            registry.register_metric("the_third_eye_cpu_mode_percent", MetricType::Gauge,
+                                     "Share of all CPU time spent in each mode (0-100).");
+            for (size_t m = 0; m < NUM_MODES; ++m) {
+                modes_[m] = registry.gauge_handle("the_third_eye_cpu_mode_percent",
+                                                  std::string(R"({mode=")") + MODE_NAMES[m] + "\"}");
+            }
+        }
+
+        cores_.set(static_cast<double>(::sysconf(_SC_NPROCESSORS_ONLN)));
+
+        // The cpu lines come first; the buffer is sized to hold them and
+        // stop short of the (potentially huge) intr/softirq lines.
+        ssize_t len = 0;
+        for (;;) {
+            len = stat_.read(buf_.data(), buf_.size());
+            if (len < 4 || buf_[0] != 'c' || buf_[1] != 'p' || buf_[2] != 'u' || buf_[3] != ' ')
+                throw std::runtime_error("unexpected /proc/stat format");
+            // Cores may have been hot-added: grow until a non-cpu line fits.
+            if (static_cast<size_t>(len) < buf_.size() - 1 || has_non_cpu_line(len)) break;
+            buf_.resize(buf_.size() * 2);
+        }
+
+        const char* end = buf_.data() + len;
+        const char* p   = buf_.data();
+
+        // Slot 0 is the aggregate line, slot N + 1 core N. Offline cores
+        // have no line, so the index is read from the line itself.
+        size_t lines = 0;
+        while (p < end && p + 3 < end && p[0] == 'c' && p[1] == 'p' && p[2] == 'u') {
+            size_t slot = 0;
+            const char* q = p + 3;
+            if (*q != ' ') {
+                uint64_t core = 0;
+                q = procfs::parse_u64(q, end, core);
+                slot = static_cast<size_t>(core) + 1;
+            }
+            if ((slot + 1) * NUM_FIELDS > cur_.size()) {
+                cur_.resize((slot + 1) * NUM_FIELDS, 0);
+                prev_.resize(cur_.size(), 0);
+            }
+            uint64_t* f = &cur_[slot * NUM_FIELDS];
+            for (size_t i = 0; i < NUM_FIELDS; ++i) q = procfs::parse_u64(q, end, f[i]);
+            lines = std::max(lines, slot + 1);
+            p = procfs::next_line(q, end);
+        }
+
+        if (has_prev_) publish(registry, lines);
+
+        prev_.swap(cur_);
+        cur_.assign(prev_.size(), 0);
+        has_prev_ = true;
+    }
+
+private:
+    // user nice system idle iowait irq softirq steal
+    static constexpr size_t NUM_FIELDS     = 8;
+    static constexpr size_t BYTES_PER_LINE = 128;
+
+    enum Mode : size_t { USER, SYSTEM, IDLE, IOWAIT, IRQ, STEAL, NUM_MODES };
+    static constexpr const char* MODE_NAMES[NUM_MODES] = {"user", "system", "idle", "iowait", "irq", "steal"};
+
+    bool has_non_cpu_line(ssize_t len) const {
+        const char* end = buf_.data() + len;
+        for (const char* p = buf_.data(); p < end; p = procfs::next_line(p, end)) {
+            if (end - p >= 3 && (p[0] != 'c' || p[1] != 'p' || p[2] != 'u')) return true;
+        }
+        return false;
+    }
+
+    void publish(Registry& registry, size_t lines) {
+        double max_core = 0.0;
+        for (size_t slot = 0; slot < lines; ++slot) {
+            const uint64_t* c = &cur_[slot * NUM_FIELDS];
+            const uint64_t* o = &prev_[slot * NUM_FIELDS];
+
+            uint64_t d[NUM_FIELDS];
+            uint64_t d_total = 0;
+            for (size_t i = 0; i < NUM_FIELDS; ++i) {
+                d[i] = c[i] >= o[i] ? c[i] - o[i] : 0;
+                d_total += d[i];
+            }
+            if (d_total == 0) continue;
+
+            uint64_t d_idle = d[3] + d[4];
+            double usage = static_cast<double>(d_total - d_idle) / static_cast<double>(d_total) * 100.0;
+
+            if (slot == 0) {
+                usage_.set(usage);
+                double scale = 100.0 / static_cast<double>(d_total);
+                modes_[USER].set(static_cast<double>(d[0] + d[1]) * scale);
+                modes_[SYSTEM].set(static_cast<double>(d[2]) * scale);
+                modes_[IDLE].set(static_cast<double>(d[3]) * scale);
+                modes_[IOWAIT].set(static_cast<double>(d[4]) * scale);
+                modes_[IRQ].set(static_cast<double>(d[5] + d[6]) * scale);
+                modes_[STEAL].set(static_cast<double>(d[7]) * scale);
+                continue;
+            }
+
+            size_t core = slot - 1;
+            while (core_usage_.size() <= core) {
+                core_usage_.push_back(registry.gauge_handle(
+                    "the_third_eye_cpu_core_usage_percent",
+                    R"({core=")" + std::to_string(core_usage_.size()) + "\"}"));
+            }
+            core_usage_[core].set(usage);
+            max_core = std::max(max_core, usage);
+        }
+        core_max_.set(max_core);
+    }
+
+    GaugeHandle usage_;
+    GaugeHandle cores_;
+    GaugeHandle core_max_;
+    GaugeHandle modes_[NUM_MODES];
+    std::vector<GaugeHandle> core_usage_;
+    procfs::ProcFile stat_;
+    std::vector<char> buf_;
+    std::vector<uint64_t> cur_;     // NUM_FIELDS counters per line, aggregate first
+    std::vector<uint64_t> prev_;
+    bool has_prev_ = false;
+};
+
+}
+
+
+std::unique_ptr<third_eye::Collector> create_cpu_collector() {
+    return std::make_unique<third_eye::CpuCollector>();
+}
+
+#endif // __linux__
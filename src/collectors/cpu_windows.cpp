@@ -1,6 +1,9 @@
 #include "third_eye/collector.hpp"
 #include "third_eye/registry.hpp"
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
 
 #ifdef _WIN32
 
@@ -13,26 +16,49 @@ namespace third_eye {
 
 /// Collects CPU utilization metrics using Windows native APIs.
 ///
-/// CPU usage is computed from the delta of GetSystemTimes() between
-/// consecutive collection cycles. The first call establishes a baseline.
+/// Overall usage is computed from the delta of GetSystemTimes() between
+/// consecutive collection cycles. Per-core usage and the user/system/idle/irq
+/// split come from NtQuerySystemInformation(SystemProcessorPerformance-
+/// Information), resolved from ntdll at construction; its counters are kept
+/// in one flat array so a cycle is a single linear pass whatever the core
+/// count. The first call establishes a baseline.
 class CpuCollector : public Collector {
 public:
+    CpuCollector() {
+        if (HMODULE ntdll = GetModuleHandleW(L"ntdll.dll")) {
+            query_ = reinterpret_cast<QueryFn>(
+                reinterpret_cast<void*>(GetProcAddress(ntdll, "NtQuerySystemInformation")));
+        }
+    }
+
     [[nodiscard]] std::string name() const override { return "cpu"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 250; }
 
     void collect(Registry& registry) override {
 
-        registry.register_metric("the_third_eye_cpu_usage_percent",
-                                 MetricType::Gauge,
-                                 "Current CPU usage as a percentage (0-100).");
-        registry.register_metric("the_third_eye_cpu_cores",
-                                 MetricType::Gauge,
-                                 "Number of logical CPU cores.");
+        if (!usage_) {
+            usage_ = registry.register_gauge("the_third_eye_cpu_usage_percent",
+                                             "Current CPU usage as a percentage (0-100).");
+            cores_ = registry.register_gauge("the_third_eye_cpu_cores",
+                                             "Number of logical CPU cores.");
+            core_max_ = registry.register_gauge("the_third_eye_cpu_core_max_percent",
+                                                "Usage of the busiest logical core as a percentage (0-100).");
+            registry.register_metric("the_third_eye_cpu_core_usage_percent", MetricType::Gauge,
+                                     "Usage of one logical core as a percentage (0-100).");
+            registry.register_metric("the_third_eye_cpu_mode_percent", MetricType::Gauge,
+                                     "Share of all CPU time spent in each mode (0-100).");
+            for (size_t m = 0; m < NUM_MODES; ++m) {
+                modes_[m] = registry.gauge_handle("the_third_eye_cpu_mode_percent",
+                                                  std::string(R"({mode=")") + MODE_NAMES[m] + "\"}");
+            }
+        }
 
 
         SYSTEM_INFO si{};
         GetSystemInfo(&si);
-        registry.gauge_set("the_third_eye_cpu_cores",
-                           static_cast<double>(si.dwNumberOfProcessors));
+        cores_.set(static_cast<double>(si.dwNumberOfProcessors));
+
+        collect_cores(registry, si.dwNumberOfProcessors);
 
 
         FILETIME idle_ft{}, kernel_ft{}, user_ft{};
@@ -58,7 +84,7 @@ public:
                 ? (static_cast<double>(busy) / static_cast<double>(total)) * 100.0
                 : 0.0;
 
-            registry.gauge_set("the_third_eye_cpu_usage_percent", usage);
+            usage_.set(usage);
         }
 
         prev_idle_   = idle;
@@ -68,6 +94,102 @@ public:
     }
 
 private:
+    // SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION; winternl.h hides the DPC
+    // and interrupt fields behind Reserved1.
+    struct ProcessorPerformance {
+        LARGE_INTEGER IdleTime;
+        LARGE_INTEGER KernelTime;      // Includes idle, DPC and interrupt time
+        LARGE_INTEGER UserTime;
+        LARGE_INTEGER DpcTime;
+        LARGE_INTEGER InterruptTime;
+        ULONG         InterruptCount;
+    };
+    using QueryFn = LONG (WINAPI*)(ULONG, PVOID, ULONG, PULONG);
+    static constexpr ULONG SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION = 8;
+
+    // idle kernel user dpc interrupt
+    static constexpr size_t NUM_FIELDS = 5;
+
+    enum Mode : size_t { USER, SYSTEM, IDLE, IRQ, NUM_MODES };
+    static constexpr const char* MODE_NAMES[NUM_MODES] = {"user", "system", "idle", "irq"};
+
+    void collect_cores(Registry& registry, DWORD n) {
+        if (!query_ || n == 0) return;
+        info_.resize(n);
+        ULONG returned = 0;
+        LONG status = query_(SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION, info_.data(),
+                             static_cast<ULONG>(info_.size() * sizeof(ProcessorPerformance)), &returned);
+        if (status < 0) return;
+        size_t cores = returned / sizeof(ProcessorPerformance);
+
+        if (cur_.size() != cores * NUM_FIELDS) {
+            cur_.assign(cores * NUM_FIELDS, 0);
+            prev_.assign(cores * NUM_FIELDS, 0);
+            has_prev_cores_ = false;
+        }
+        for (size_t i = 0; i < cores; ++i) {
+            uint64_t* f = &cur_[i * NUM_FIELDS];
+            f[0] = static_cast<uint64_t>(info_[i].IdleTime.QuadPart);
+            f[1] = static_cast<uint64_t>(info_[i].KernelTime.QuadPart);
+            f[2] = static_cast<uint64_t>(info_[i].UserTime.QuadPart);
+            f[3] = static_cast<uint64_t>(info_[i].DpcTime.QuadPart);
+            f[4] = static_cast<uint64_t>(info_[i].InterruptTime.QuadPart);
+        }
+
+        if (has_prev_cores_) publish_cores(registry, cores);
+        prev_.swap(cur_);
+        has_prev_cores_ = true;
+    }
+
+    void publish_cores(Registry& registry, size_t cores) {
+        uint64_t sum[NUM_MODES]{};
+        uint64_t sum_total = 0;
+        double max_core = 0.0;
+
+        for (size_t i = 0; i < cores; ++i) {
+            const uint64_t* c = &cur_[i * NUM_FIELDS];
+            const uint64_t* o = &prev_[i * NUM_FIELDS];
+            uint64_t d[NUM_FIELDS];
+            for (size_t k = 0; k < NUM_FIELDS; ++k) d[k] = c[k] >= o[k] ? c[k] - o[k] : 0;
+
+            uint64_t total = d[1] + d[2];
+            if (total == 0) continue;
+            uint64_t idle = std::min(d[0], d[1]);
+            uint64_t irq  = std::min(d[3] + d[4], d[1] - idle);
+
+            sum[USER]   += d[2];
+            sum[SYSTEM] += d[1] - idle - irq;
+            sum[IDLE]   += idle;
+            sum[IRQ]    += irq;
+            sum_total   += total;
+
+            while (core_usage_.size() <= i) {
+                core_usage_.push_back(registry.gauge_handle(
+                    "the_third_eye_cpu_core_usage_percent",
+                    R"({core=")" + std::to_string(core_usage_.size()) + "\"}"));
+            }
+            double usage = static_cast<double>(total - idle) / static_cast<double>(total) * 100.0;
+            core_usage_[i].set(usage);
+            max_core = std::max(max_core, usage);
+        }
+        core_max_.set(max_core);
+
+        if (sum_total == 0) return;
+        for (size_t m = 0; m < NUM_MODES; ++m) {
+            modes_[m].set(static_cast<double>(sum[m]) / static_cast<double>(sum_total) * 100.0);
+        }
+    }
+
+    GaugeHandle usage_;
+    GaugeHandle cores_;
+    GaugeHandle core_max_;
+    GaugeHandle modes_[NUM_MODES];
+    std::vector<GaugeHandle> core_usage_;
+    QueryFn  query_ = nullptr;
+    std::vector<ProcessorPerformance> info_;
+    std::vector<uint64_t> cur_;     // NUM_FIELDS counters per core
+    std::vector<uint64_t> prev_;
+    bool     has_prev_cores_ = false;
     bool     has_prev_    = false;
     uint64_t prev_idle_   = 0;
     uint64_t prev_kernel_ = 0;
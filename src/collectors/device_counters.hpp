@@ -0,0 +1,100 @@
+#pragma once
+
+#include "process_table.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace third_eye {
+
+
+/// Per-device state for collectors that turn cumulative counters (bytes,
+/// packets, I/Os) into per-second rates: network interfaces, disks.
+///
+/// Devices are kept in the order the OS lists them, which rarely changes,
+/// so looking one up starts where the previous lookup left off and is O(1)
+/// in the steady state. Devices not seen during a cycle are dropped at its
+/// end. A counter that goes backwards (driver reload, wrap) yields a zero
+/// delta rather than a huge rate.
+template <size_t N>
+class DeviceCounters {
+public:
+    using Counters = std::array<uint64_t, N>;
+
+    struct Device {
+        std::string name;
+        std::string label;           // {<key>="<name>"}, built once
+        Counters    prev{};
+        bool        has_prev = false;
+        bool        skip     = false;   // Caller-decided, e.g. partitions
+        uint64_t    seen     = 0;
+    };
+
+    explicit DeviceCounters(const char* label_key) : label_key_(label_key) {}
+
+    /// Starts a cycle; returns the seconds elapsed since the previous one
+    /// (0 on the first call).
+    double begin_cycle() {
+        ++epoch_;
+        auto now = std::chrono::steady_clock::now();
+        double dt = epoch_ > 1 ? std::chrono::duration<double>(now - last_).count() : 0.0;
+        last_ = now;
+        return dt;
+    }
+
+    /// Device `name`, marked as seen; `inserted` is set when it is new.
+    /// Devices live in a deque, so references (and views of their labels)
+    /// stay valid until the next sweep().
+    Device& touch(std::string_view name, bool& inserted) {
+        for (size_t n = 0; n < devices_.size(); ++n, cursor_ = (cursor_ + 1) % devices_.size()) {
+            if (devices_[cursor_].name == name) {
+                inserted = false;
+                Device& d = devices_[cursor_];
+                cursor_ = (cursor_ + 1) % devices_.size();
+                d.seen = epoch_;
+                return d;
+            }
+        }
+        inserted = true;
+        Device& d = devices_.emplace_back();
+        d.name  = name;
+        d.label.push_back('{');
+        d.label.append(label_key_).append("=\"");
+        append_label_value(d.label, name);
+        d.label += "\"}";
+        d.seen  = epoch_;
+        cursor_ = 0;
+        return d;
+    }
+
+    /// Stores `cur` as the device's baseline and writes the increase since
+    /// the previous cycle to `delta`. False on a device's first cycle.
+    static bool advance(Device& d, const Counters& cur, Counters& delta) {
+        bool ok = d.has_prev;
+        for (size_t i = 0; i < N; ++i) delta[i] = cur[i] >= d.prev[i] ? cur[i] - d.prev[i] : 0;
+        d.prev     = cur;
+        d.has_prev = true;
+        return ok;
+    }
+
+    /// Drops devices that disappeared during the cycle.
+    void sweep() {
+        std::erase_if(devices_, [this](const Device& d) { return d.seen != epoch_; });
+        cursor_ = 0;
+    }
+
+private:
+    const char* label_key_;
+    std::deque<Device> devices_;
+    size_t   cursor_ = 0;
+    uint64_t epoch_  = 0;
+    std::chrono::steady_clock::time_point last_{};
+};
+
+}
@@ -0,0 +1,124 @@
+#include "third_eye/collector.hpp"
+#include "third_eye/registry.hpp"
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+
+#include "procfs_linux.hpp"
+#include "device_counters.hpp"
+
+namespace third_eye {
+
+/// Per-disk I/O throughput, IOPS and queue depth from /proc/diskstats.
+///
+/// Only whole block devices (those listed in /sys/block) are reported, so
+/// partitions do not double count; loop and ram devices are skipped. Rates
+/// are the counter deltas between consecutive cycles divided by the elapsed
+/// time; the queue depth is the average number of I/Os in flight over the
+/// interval, from the weighted time spent doing I/O (as iostat's aqu-sz).
+class DiskCollector : public Collector {
+public:
+    DiskCollector() : stats_("/proc/diskstats") {}
+
+    [[nodiscard]] std::string name() const override { return "disk"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 1000; }
+
+    void collect(Registry& registry) override {
+        if (!registered_) {
+            for (size_t i = 0; i < NUM_FIELDS; ++i) {
+                registry.register_metric(METRICS[i].name, MetricType::Gauge, METRICS[i].help);
+            }
+            registered_ = true;
+        }
+
+        ssize_t len = stats_.read(buf_);
+        if (len <= 0) throw std::runtime_error("failed to read /proc/diskstats");
+        const char* end = buf_.data() + len;
+
+        double dt = devices_.begin_cycle();
+        for (auto& v : values_) v.clear();
+
+        // "major minor name reads merged sectors ms writes merged sectors ms
+        // in_flight io_ms weighted_ms ..."; sectors are always 512 bytes.
+        for (const char* p = buf_.data(); p < end; p = procfs::next_line(p, end)) {
+            const char* q = procfs::skip_field(p, end);
+            q = procfs::skip_field(q, end);
+            const char* name = procfs::skip_spaces(q, end);
+            q = procfs::skip_field(q, end);
+            if (q == name) break;
+            std::string_view dev_name(name, static_cast<size_t>(q - name));
+
+            uint64_t f[11]{};
+            for (auto& v : f) q = procfs::parse_u64(q, end, v);
+
+            Counters cur{};
+            cur[READ_BYTES]  = f[2] * 512;
+            cur[WRITE_BYTES] = f[6] * 512;
+            cur[READS]       = f[0];
+            cur[WRITES]      = f[4];
+            cur[QUEUE_DEPTH] = f[10];   // Weighted milliseconds
+
+            bool inserted = false;
+            auto& dev = devices_.touch(dev_name, inserted);
+            if (inserted) dev.skip = !is_whole_disk(dev.name);
+            if (dev.skip) continue;
+
+            Counters delta{};
+            if (!Devices::advance(dev, cur, delta) || dt <= 0.0) continue;
+            for (size_t i = 0; i < QUEUE_DEPTH; ++i) {
+                values_[i].emplace_back(dev.label, static_cast<double>(delta[i]) / dt);
+            }
+            values_[QUEUE_DEPTH].emplace_back(dev.label, static_cast<double>(delta[QUEUE_DEPTH]) / (dt * 1000.0));
+        }
+
+        if (dt > 0.0) {
+            for (size_t i = 0; i < NUM_FIELDS; ++i) registry.gauge_replace_all(METRICS[i].name, values_[i]);
+        }
+        devices_.sweep();
+    }
+
+private:
+    enum Field : size_t { READ_BYTES, WRITE_BYTES, READS, WRITES, QUEUE_DEPTH, NUM_FIELDS };
+    using Devices  = DeviceCounters<NUM_FIELDS>;
+    using Counters = Devices::Counters;
+
+    struct Metric { const char* name; const char* help; };
+    static constexpr Metric METRICS[NUM_FIELDS] = {
+        {"the_third_eye_disk_read_bytes_per_second",  "Bytes read per second from a disk."},
+        {"the_third_eye_disk_write_bytes_per_second", "Bytes written per second to a disk."},
+        {"the_third_eye_disk_reads_per_second",       "Read operations per second on a disk."},
+        {"the_third_eye_disk_writes_per_second",      "Write operations per second on a disk."},
+        {"the_third_eye_disk_queue_depth",            "Average number of I/Os in flight on a disk (instantaneous on Windows)."},
+    };
+
+    static bool is_whole_disk(const std::string& name) {
+        if (name.starts_with("loop") || name.starts_with("ram")) return false;
+        // Device names with a '/' appear in /sys/block with '!' instead.
+        std::string sys = "/sys/block/" + name;
+        for (size_t i = 11; i < sys.size(); ++i) {
+            if (sys[i] == '/') sys[i] = '!';
+        }
+        return ::access(sys.c_str(), F_OK) == 0;
+    }
+
+    procfs::ProcFile stats_;
+    std::vector<char> buf_;
+    Devices devices_{"device"};
+    // Labels are views of the device labels, valid until the next sweep.
+    std::vector<std::pair<std::string_view, double>> values_[NUM_FIELDS];
+    bool registered_ = false;
+};
+
+}
+
+
+std::unique_ptr<third_eye::Collector> create_disk_collector() {
+    return std::make_unique<third_eye::DiskCollector>();
+}
+
+#endif // __linux__
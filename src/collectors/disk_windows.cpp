@@ -0,0 +1,137 @@
+#include "third_eye/collector.hpp"
+#include "third_eye/registry.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <winioctl.h>
+#include <cstdio>
+
+#include "device_counters.hpp"
+
+namespace third_eye {
+
+/// Per-disk I/O throughput, IOPS and queue depth from
+/// IOCTL_DISK_PERFORMANCE on each \\.\PhysicalDriveN.
+///
+/// Drive handles are opened without read/write access (enough for the
+/// ioctl, and no elevation needed) and kept across cycles; the drive list
+/// is re-probed every RESCAN_CYCLES cycles or when a handle fails. Rates are
+/// the counter deltas between consecutive cycles divided by the elapsed
+/// time; the queue depth is the driver's instantaneous count.
+class DiskCollector : public Collector {
+public:
+    ~DiskCollector() override { close_drives(); }
+
+    [[nodiscard]] std::string name() const override { return "disk"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 1000; }
+
+    void collect(Registry& registry) override {
+        if (!registered_) {
+            for (size_t i = 0; i < NUM_FIELDS; ++i) {
+                registry.register_metric(METRICS[i].name, MetricType::Gauge, METRICS[i].help);
+            }
+            registered_ = true;
+        }
+
+        if (cycles_++ % RESCAN_CYCLES == 0) probe_drives();
+
+        double dt = devices_.begin_cycle();
+        for (auto& v : values_) v.clear();
+
+        bool failed = false;
+        for (const auto& drive : drives_) {
+            DISK_PERFORMANCE perf{};
+            DWORD returned = 0;
+            if (!DeviceIoControl(drive.handle, IOCTL_DISK_PERFORMANCE, nullptr, 0,
+                                 &perf, sizeof(perf), &returned, nullptr)) {
+                failed = true;
+                continue;
+            }
+
+            Counters cur{};
+            cur[READ_BYTES]  = static_cast<uint64_t>(perf.BytesRead.QuadPart);
+            cur[WRITE_BYTES] = static_cast<uint64_t>(perf.BytesWritten.QuadPart);
+            cur[READS]       = perf.ReadCount;
+            cur[WRITES]      = perf.WriteCount;
+
+            bool inserted = false;
+            auto& dev = devices_.touch(drive.name, inserted);
+            Counters delta{};
+            if (!Devices::advance(dev, cur, delta) || dt <= 0.0) continue;
+            for (size_t i = 0; i < QUEUE_DEPTH; ++i) {
+                values_[i].emplace_back(dev.label, static_cast<double>(delta[i]) / dt);
+            }
+            values_[QUEUE_DEPTH].emplace_back(dev.label, static_cast<double>(perf.QueueDepth));
+        }
+        if (failed) cycles_ = 0;   // Re-probe next cycle
+
+        if (dt > 0.0) {
+            for (size_t i = 0; i < NUM_FIELDS; ++i) registry.gauge_replace_all(METRICS[i].name, values_[i]);
+        }
+        devices_.sweep();
+    }
+
+private:
+    enum Field : size_t { READ_BYTES, WRITE_BYTES, READS, WRITES, QUEUE_DEPTH, NUM_FIELDS };
+    using Devices  = DeviceCounters<NUM_FIELDS>;
+    using Counters = Devices::Counters;
+
+    static constexpr int      MAX_DRIVES    = 64;
+    static constexpr uint64_t RESCAN_CYCLES = 60;
+
+    struct Metric { const char* name; const char* help; };
+    static constexpr Metric METRICS[NUM_FIELDS] = {
+        {"the_third_eye_disk_read_bytes_per_second",  "Bytes read per second from a disk."},
+        {"the_third_eye_disk_write_bytes_per_second", "Bytes written per second to a disk."},
+        {"the_third_eye_disk_reads_per_second",       "Read operations per second on a disk."},
+        {"the_third_eye_disk_writes_per_second",      "Write operations per second on a disk."},
+        {"the_third_eye_disk_queue_depth",            "Average number of I/Os in flight on a disk (instantaneous on Windows)."},
+    };
+
+    struct Drive {
+        std::string name;    // PhysicalDriveN
+        HANDLE      handle;
+    };
+
+    void probe_drives() {
+        close_drives();
+        for (int i = 0; i < MAX_DRIVES; ++i) {
+            wchar_t path[32];
+            std::swprintf(path, 32, L"\\\\.\\PhysicalDrive%d", i);
+            HANDLE h = CreateFileW(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                   OPEN_EXISTING, 0, nullptr);
+            if (h == INVALID_HANDLE_VALUE) continue;
+            drives_.push_back({"PhysicalDrive" + std::to_string(i), h});
+        }
+    }
+
+    void close_drives() {
+        for (auto& d : drives_) CloseHandle(d.handle);
+        drives_.clear();
+    }
+
+    std::vector<Drive> drives_;
+    uint64_t cycles_ = 0;
+    Devices devices_{"device"};
+    // Labels are views of the device labels, valid until the next sweep.
+    std::vector<std::pair<std::string_view, double>> values_[NUM_FIELDS];
+    bool registered_ = false;
+};
+
+}
+
+
+std::unique_ptr<third_eye::Collector> create_disk_collector() {
+    return std::make_unique<third_eye::DiskCollector>();
+}
+
+#endif // _WIN32
@@ -0,0 +1,74 @@
+#include "third_eye/collector.hpp"
+#include "third_eye/registry.hpp"
+#include <memory>
+#include <stdexcept>
+
+#ifdef __linux__
+
+#include "procfs_linux.hpp"
+
+namespace third_eye {
+
+
+class MemoryCollector : public Collector {
+public:
+    MemoryCollector() : meminfo_("/proc/meminfo") {}
+
+    [[nodiscard]] std::string name() const override { return "memory"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 250; }
+
+    void collect(Registry& registry) override {
+        if (!total_) {
+            total_ = registry.register_gauge("the_third_eye_memory_total_bytes",
+                                             "Total physical memory in bytes.");
+            used_  = registry.register_gauge("the_third_eye_memory_used_bytes",
+                                             "Used physical memory in bytes.");
+            avail_ = registry.register_gauge("the_third_eye_memory_available_bytes",
+                                             "Available physical memory in bytes.");
+        }
+
+        char buf[4096];
+        ssize_t len = meminfo_.read(buf, sizeof(buf));
+        if (len <= 0) throw std::runtime_error("failed to read /proc/meminfo");
+        const char* end = buf + len;
+
+        // MemTotal and MemAvailable are the first and third lines on every
+        // kernel since 3.14, so the forward scan stops almost immediately.
+        uint64_t total_kb = 0, avail_kb = 0;
+        const char* p = procfs::find_key(buf, end, "MemTotal:");
+        if (!p) throw std::runtime_error("MemTotal missing from /proc/meminfo");
+        p = procfs::parse_u64(p, end, total_kb);
+
+        const char* a = procfs::find_key(p, end, "MemAvailable:");
+        if (a) {
+            procfs::parse_u64(a, end, avail_kb);
+        } else {
+            // Pre-3.14 kernels: approximate with MemFree + Buffers + Cached.
+            uint64_t v = 0;
+            if ((a = procfs::find_key(buf, end, "MemFree:")))  { procfs::parse_u64(a, end, v); avail_kb += v; }
+            if ((a = procfs::find_key(buf, end, "Buffers:")))  { procfs::parse_u64(a, end, v); avail_kb += v; }
+            if ((a = procfs::find_key(buf, end, "Cached:")))   { procfs::parse_u64(a, end, v); avail_kb += v; }
+        }
+
+        auto total = static_cast<double>(total_kb) * 1024.0;
+        auto avail = static_cast<double>(avail_kb) * 1024.0;
+
+        total_.set(total);
+        avail_.set(avail);
+        used_.set(total - avail);
+    }
+
+private:
+    GaugeHandle total_;
+    GaugeHandle used_;
+    GaugeHandle avail_;
+    procfs::ProcFile meminfo_;
+};
+
+}
+
+std::unique_ptr<third_eye::Collector> create_memory_collector() {
+    return std::make_unique<third_eye::MemoryCollector>();
+}
+
+#endif // __linux__
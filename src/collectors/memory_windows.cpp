@@ -15,17 +15,17 @@ namespace third_eye {
 class MemoryCollector : public Collector {
 public:
     [[nodiscard]] std::string name() const override { return "memory"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 250; }
 
     void collect(Registry& registry) override {
-        registry.register_metric("the_third_eye_memory_total_bytes",
-                                 MetricType::Gauge,
-                                 "Total physical memory in bytes.");
-        registry.register_metric("the_third_eye_memory_used_bytes",
-                                 MetricType::Gauge,
-                                 "Used physical memory in bytes.");
-        registry.register_metric("the_third_eye_memory_available_bytes",
-                                 MetricType::Gauge,
-                                 "Available physical memory in bytes.");
+        if (!total_) {
+            total_ = registry.register_gauge("the_third_eye_memory_total_bytes",
+                                             "Total physical memory in bytes.");
+            used_  = registry.register_gauge("the_third_eye_memory_used_bytes",
+                                             "Used physical memory in bytes.");
+            avail_ = registry.register_gauge("the_third_eye_memory_available_bytes",
+                                             "Available physical memory in bytes.");
+        }
 
         MEMORYSTATUSEX mem{};
         mem.dwLength = sizeof(mem);
@@ -34,10 +34,15 @@ public:
         auto total = static_cast<double>(mem.ullTotalPhys);
         auto avail = static_cast<double>(mem.ullAvailPhys);
 
-        registry.gauge_set("the_third_eye_memory_total_bytes", total);
-        registry.gauge_set("the_third_eye_memory_available_bytes", avail);
-        registry.gauge_set("the_third_eye_memory_used_bytes",  total - avail);
+        total_.set(total);
+        avail_.set(avail);
+        used_.set(total - avail);
     }
+
+private:
+    GaugeHandle total_;
+    GaugeHandle used_;
+    GaugeHandle avail_;
 };
 
 }
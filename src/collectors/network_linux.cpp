@@ -0,0 +1,107 @@
+#include "third_eye/collector.hpp"
+#include "third_eye/registry.hpp"
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+
+#include "procfs_linux.hpp"
+#include "device_counters.hpp"
+
+namespace third_eye {
+
+/// Per-interface network throughput from /proc/net/dev.
+///
+/// The file holds cumulative counters since boot; rates are the deltas
+/// between consecutive cycles divided by the elapsed time. The first cycle
+/// (and the first cycle of a new interface) establishes a baseline.
+class NetworkCollector : public Collector {
+public:
+    NetworkCollector() : dev_("/proc/net/dev") {}
+
+    [[nodiscard]] std::string name() const override { return "network"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 1000; }
+
+    void collect(Registry& registry) override {
+        if (!registered_) {
+            for (size_t i = 0; i < NUM_FIELDS; ++i) {
+                registry.register_metric(METRICS[i].name, MetricType::Gauge, METRICS[i].help);
+            }
+            registered_ = true;
+        }
+
+        ssize_t len = dev_.read(buf_);
+        if (len <= 0) throw std::runtime_error("failed to read /proc/net/dev");
+        const char* end = buf_.data() + len;
+
+        double dt = devices_.begin_cycle();
+        for (auto& r : rates_) r.clear();
+
+        // Two header lines, then "  name: rx_bytes rx_packets rx_errs ...
+        // (8 receive fields) tx_bytes tx_packets tx_errs ...".
+        const char* p = procfs::next_line(procfs::next_line(buf_.data(), end), end);
+        for (; p < end; p = procfs::next_line(p, end)) {
+            const char* colon = static_cast<const char*>(std::memchr(p, ':', static_cast<size_t>(end - p)));
+            if (!colon) break;
+            const char* name = procfs::skip_spaces(p, colon);
+
+            Counters cur{};
+            const char* q = colon + 1;
+            q = procfs::parse_u64(q, end, cur[RX_BYTES]);
+            q = procfs::parse_u64(q, end, cur[RX_PACKETS]);
+            q = procfs::parse_u64(q, end, cur[RX_ERRORS]);
+            for (int field = 3; field < 8; ++field) q = procfs::skip_field(q, end);
+            q = procfs::parse_u64(q, end, cur[TX_BYTES]);
+            q = procfs::parse_u64(q, end, cur[TX_PACKETS]);
+            procfs::parse_u64(q, end, cur[TX_ERRORS]);
+
+            bool inserted = false;
+            auto& dev = devices_.touch(std::string_view(name, static_cast<size_t>(colon - name)), inserted);
+            Counters delta{};
+            if (!Devices::advance(dev, cur, delta) || dt <= 0.0) continue;
+            for (size_t i = 0; i < NUM_FIELDS; ++i) {
+                rates_[i].emplace_back(dev.label, static_cast<double>(delta[i]) / dt);
+            }
+        }
+
+        if (dt > 0.0) {
+            for (size_t i = 0; i < NUM_FIELDS; ++i) registry.gauge_replace_all(METRICS[i].name, rates_[i]);
+        }
+        devices_.sweep();
+    }
+
+private:
+    enum Field : size_t { RX_BYTES, RX_PACKETS, RX_ERRORS, TX_BYTES, TX_PACKETS, TX_ERRORS, NUM_FIELDS };
+    using Devices  = DeviceCounters<NUM_FIELDS>;
+    using Counters = Devices::Counters;
+
+    struct Metric { const char* name; const char* help; };
+    static constexpr Metric METRICS[NUM_FIELDS] = {
+        {"the_third_eye_network_receive_bytes_per_second",    "Bytes received per second on an interface."},
+        {"the_third_eye_network_receive_packets_per_second",  "Packets received per second on an interface."},
+        {"the_third_eye_network_receive_errors_per_second",   "Receive errors per second on an interface."},
+        {"the_third_eye_network_transmit_bytes_per_second",   "Bytes transmitted per second on an interface."},
+        {"the_third_eye_network_transmit_packets_per_second", "Packets transmitted per second on an interface."},
+        {"the_third_eye_network_transmit_errors_per_second",  "Transmit errors per second on an interface."},
+    };
+
+    procfs::ProcFile dev_;
+    std::vector<char> buf_;
+    Devices devices_{"interface"};
+    // Labels are views of the device labels, valid until the next sweep.
+    std::vector<std::pair<std::string_view, double>> rates_[NUM_FIELDS];
+    bool registered_ = false;
+};
+
+}
+
+
+std::unique_ptr<third_eye::Collector> create_network_collector() {
+    return std::make_unique<third_eye::NetworkCollector>();
+}
+
+#endif // __linux__
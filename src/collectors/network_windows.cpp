@@ -0,0 +1,108 @@
+#include "third_eye/collector.hpp"
+#include "third_eye/registry.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <windows.h>
+#include <iphlpapi.h>
+
+#include "device_counters.hpp"
+
+namespace third_eye {
+
+/// Per-interface network throughput from GetIfTable2().
+///
+/// Only hardware interfaces are reported; the filter and virtual rows
+/// Windows stacks on top of them would double count. Rates are the counter
+/// deltas between consecutive cycles divided by the elapsed time. The first
+/// cycle (and the first cycle of a new interface) establishes a baseline.
+class NetworkCollector : public Collector {
+public:
+    [[nodiscard]] std::string name() const override { return "network"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 1000; }
+
+    void collect(Registry& registry) override {
+        if (!registered_) {
+            for (size_t i = 0; i < NUM_FIELDS; ++i) {
+                registry.register_metric(METRICS[i].name, MetricType::Gauge, METRICS[i].help);
+            }
+            registered_ = true;
+        }
+
+        MIB_IF_TABLE2* table = nullptr;
+        if (GetIfTable2(&table) != NO_ERROR || !table) return;
+
+        double dt = devices_.begin_cycle();
+        for (auto& r : rates_) r.clear();
+
+        for (ULONG i = 0; i < table->NumEntries; ++i) {
+            const MIB_IF_ROW2& row = table->Table[i];
+            if (!row.InterfaceAndOperStatusFlags.HardwareInterface ||
+                row.InterfaceAndOperStatusFlags.FilterInterface) continue;
+
+            char alias[(IF_MAX_STRING_SIZE + 1) * 3]{};
+            int n = WideCharToMultiByte(CP_UTF8, 0, row.Alias, -1, alias, sizeof(alias), nullptr, nullptr);
+            if (n <= 1) continue;
+
+            Counters cur{};
+            cur[RX_BYTES]   = row.InOctets;
+            cur[RX_PACKETS] = row.InUcastPkts + row.InNUcastPkts;
+            cur[RX_ERRORS]  = row.InErrors;
+            cur[TX_BYTES]   = row.OutOctets;
+            cur[TX_PACKETS] = row.OutUcastPkts + row.OutNUcastPkts;
+            cur[TX_ERRORS]  = row.OutErrors;
+
+            bool inserted = false;
+            auto& dev = devices_.touch(std::string_view(alias, static_cast<size_t>(n - 1)), inserted);
+            Counters delta{};
+            if (!Devices::advance(dev, cur, delta) || dt <= 0.0) continue;
+            for (size_t f = 0; f < NUM_FIELDS; ++f) {
+                rates_[f].emplace_back(dev.label, static_cast<double>(delta[f]) / dt);
+            }
+        }
+        FreeMibTable(table);
+
+        if (dt > 0.0) {
+            for (size_t i = 0; i < NUM_FIELDS; ++i) registry.gauge_replace_all(METRICS[i].name, rates_[i]);
+        }
+        devices_.sweep();
+    }
+
+private:
+    enum Field : size_t { RX_BYTES, RX_PACKETS, RX_ERRORS, TX_BYTES, TX_PACKETS, TX_ERRORS, NUM_FIELDS };
+    using Devices  = DeviceCounters<NUM_FIELDS>;
+    using Counters = Devices::Counters;
+
+    struct Metric { const char* name; const char* help; };
+    static constexpr Metric METRICS[NUM_FIELDS] = {
+        {"the_third_eye_network_receive_bytes_per_second",    "Bytes received per second on an interface."},
+        {"the_third_eye_network_receive_packets_per_second",  "Packets received per second on an interface."},
+        {"the_third_eye_network_receive_errors_per_second",   "Receive errors per second on an interface."},
+        {"the_third_eye_network_transmit_bytes_per_second",   "Bytes transmitted per second on an interface."},
+        {"the_third_eye_network_transmit_packets_per_second", "Packets transmitted per second on an interface."},
+        {"the_third_eye_network_transmit_errors_per_second",  "Transmit errors per second on an interface."},
+    };
+
+    Devices devices_{"interface"};
+    // Labels are views of the device labels, valid until the next sweep.
+    std::vector<std::pair<std::string_view, double>> rates_[NUM_FIELDS];
+    bool registered_ = false;
+};
+
+}
+
+
+std::unique_ptr<third_eye::Collector> create_network_collector() {
+    return std::make_unique<third_eye::NetworkCollector>();
+}
+
+#endif // _WIN32
@@ -0,0 +1,311 @@
+#include "third_eye/collector.hpp"
+#include "third_eye/registry.hpp"
+#include "third_eye/agent.hpp"
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <chrono>
+#include <stdexcept>
+
+#ifdef __linux__
+
+#include "procfs_linux.hpp"
+#include "process_table.hpp"
+#include "process_top.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+namespace third_eye {
+
+/// Fields of /proc/<pid>/stat that the collector needs (see proc(5)).
+struct PidStat {
+    const char* comm;
+    size_t      comm_len;
+    uint64_t    ppid;
+    uint64_t    majflt;
+    uint64_t    utime;
+    uint64_t    stime;
+    uint64_t    num_threads;
+    uint64_t    starttime;
+    uint64_t    rss_pages;
+};
+
+/// Parses "pid (comm) state ppid ... majflt cmajflt utime stime ...
+/// num_threads itrealvalue starttime vsize rss".
+/// comm may contain spaces and parentheses, so it is delimited by the
+/// first '(' and the last ')'.
+static bool parse_pid_stat(const char* buf, size_t len, PidStat& out) {
+    const char* end   = buf + len;
+    const char* open  = static_cast<const char*>(std::memchr(buf, '(', len));
+    const char* close = static_cast<const char*>(memrchr(buf, ')', len));
+    if (!open || !close || close < open) return false;
+
+    out.comm     = open + 1;
+    out.comm_len = static_cast<size_t>(close - open - 1);
+
+    // Field 3 (state) follows ") "; majflt is field 12, utime field 14.
+    const char* p = close + 1;
+    p = procfs::skip_field(p, end);                     // state
+    p = procfs::parse_u64(p, end, out.ppid);
+    for (int field = 5; field < 12; ++field) p = procfs::skip_field(p, end);
+    p = procfs::parse_u64(p, end, out.majflt);
+    p = procfs::skip_field(p, end);                     // cmajflt
+    p = procfs::parse_u64(p, end, out.utime);
+    p = procfs::parse_u64(p, end, out.stime);
+    for (int field = 16; field < 20; ++field) p = procfs::skip_field(p, end);
+    p = procfs::parse_u64(p, end, out.num_threads);
+    p = procfs::skip_field(p, end);                     // itrealvalue
+    p = procfs::parse_u64(p, end, out.starttime);
+    p = procfs::skip_field(p, end);                     // vsize
+    procfs::parse_u64(p, end, out.rss_pages);
+    return true;
+}
+
+class ProcessCollector : public Collector {
+public:
+    explicit ProcessCollector(int top_n, Agent* agent)
+        : top_n_(static_cast<size_t>(std::clamp(top_n, 1, Agent::MAX_TOP_N))), agent_(agent), stat_("/proc/stat") {
+        if (agent_) {
+            export_all_ = agent_->config().export_all_processes;
+            by_tree_    = agent_->config().group_by_tree;
+            budget_     = agent_->config().process_budget;
+        }
+        proc_dir_  = ::opendir("/proc");
+        page_size_ = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+        num_cpus_  = static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN));
+
+        // Keeping descriptors open per process is what makes a cycle cheap,
+        // but they share RLIMIT_NOFILE with HTTP sockets and history
+        // segments, so cache at most FD_BUDGET of them and never more than
+        // half the soft limit. Beyond that, fall back to open/pread/close.
+        rlimit rl{};
+        if (::getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+            fd_budget_ = std::min(FD_BUDGET, static_cast<size_t>(rl.rlim_cur / 2));
+        }
+    }
+
+    ~ProcessCollector() override {
+        if (proc_dir_) ::closedir(proc_dir_);
+    }
+
+    [[nodiscard]] std::string name() const override { return "process"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 5000; }
+
+    void collect(Registry& registry) override {
+        register_process_metrics(registry);
+
+        if (!proc_dir_) throw std::runtime_error("cannot open /proc");
+
+        uint64_t sys_total = read_total_ticks();
+        uint64_t d_sys     = (has_prev_ && sys_total > prev_sys_total_) ? sys_total - prev_sys_total_ : 0;
+        prev_sys_total_    = sys_total;
+        auto now   = std::chrono::steady_clock::now();
+        elapsed_s_ = has_prev_ ? std::chrono::duration<double>(now - prev_time_).count() : 0.0;
+        prev_time_ = now;
+
+        table_.begin_cycle();
+        computed_.clear();
+        scan_processes(d_sys);
+
+        // Drop processes that exited since the last cycle.
+        table_.sweep([this](Table::Slot& s) {
+            if (s.extra.stat.is_open()) --open_fds_;
+            if (s.extra.io.is_open())   --open_fds_;
+        });
+
+        publish_top_processes(computed_, top_n_, registry, agent_, series_, !export_all_);
+        if (export_all_) publish_all_processes(computed_, budget_, registry, series_);
+
+        if (by_tree_) {
+            for (auto& p : computed_) p.leader = table_.group_leader(p.pid);
+        }
+        grouper_.publish(computed_, top_n_, by_tree_, registry, agent_);
+        has_prev_ = true;
+    }
+
+private:
+    // Extra per-process state: cached /proc/<pid>/stat and /proc/<pid>/io
+    // descriptors. io and fd/ are only readable for processes we may
+    // ptrace; once refused they are not retried until the PID changes hands.
+    struct Files {
+        procfs::ProcFile stat;
+        procfs::ProcFile io;
+        bool             io_denied = false;
+        bool             fd_denied = false;
+    };
+    using Table = ProcessTable<Files>;
+
+    /// Reads a cached descriptor, or opens path and caches it while within
+    /// the fd budget. Returns the bytes read, <= 0 on failure.
+    ssize_t read_cached(procfs::ProcFile& cached, const char* path, char* buf, size_t cap) {
+        ssize_t len = -1;
+        if (cached.is_open()) {
+            len = cached.read(buf, cap);
+            // A cached descriptor of an exited process keeps failing
+            // even if the PID has been reused; reopen once.
+            if (len <= 0) { cached.close(); --open_fds_; }
+        }
+        if (len <= 0) {
+            procfs::ProcFile f(path);
+            len = f.read(buf, cap);
+            if (len > 0 && open_fds_ < fd_budget_) {
+                cached = std::move(f);
+                ++open_fds_;
+            }
+        }
+        return len;
+    }
+
+    /// Storage bytes read and written from /proc/<pid>/io.
+    void read_io(Table::Slot& t, pid_t pid, ProcCpu& out) {
+        if (t.extra.io_denied) return;
+        char path[32];
+        char buf[512];
+        std::snprintf(path, sizeof(path), "/proc/%d/io", static_cast<int>(pid));
+        ssize_t len = read_cached(t.extra.io, path, buf, sizeof(buf));
+        if (len <= 0) {
+            if (errno == EACCES || errno == EPERM) t.extra.io_denied = true;
+            return;
+        }
+        const char* end = buf + len;
+        if (const char* p = procfs::find_key(buf, end, "read_bytes:"))  procfs::parse_u64(p, end, out.io_read);
+        if (const char* p = procfs::find_key(buf, end, "write_bytes:")) procfs::parse_u64(p, end, out.io_write);
+    }
+
+    /// Open descriptors of a process. Since Linux 6.2 the size of
+    /// /proc/<pid>/fd is the descriptor count, which costs one stat();
+    /// older kernels report 0 and the directory is walked instead.
+    void count_fds(Table::Slot& t, pid_t pid, ProcCpu& out) {
+        if (t.extra.fd_denied) return;
+        char path[32];
+        std::snprintf(path, sizeof(path), "/proc/%d/fd", static_cast<int>(pid));
+
+        struct stat st{};
+        if (::stat(path, &st) != 0) {
+            if (errno == EACCES || errno == EPERM) t.extra.fd_denied = true;
+            return;
+        }
+        if (st.st_size > 0) {
+            out.handles = static_cast<uint32_t>(st.st_size);
+            return;
+        }
+
+        DIR* dir = ::opendir(path);
+        if (!dir) {
+            if (errno == EACCES || errno == EPERM) t.extra.fd_denied = true;
+            return;
+        }
+        uint32_t n = 0;
+        while (dirent* de = ::readdir(dir)) {
+            if (de->d_name[0] != '.') ++n;
+        }
+        ::closedir(dir);
+        out.handles = n;
+    }
+
+    uint64_t read_total_ticks() {
+        char buf[512];
+        ssize_t len = stat_.read(buf, sizeof(buf));
+        if (len < 4) return 0;
+        const char* end = buf + len;
+        const char* p   = buf + 3;
+        uint64_t total = 0;
+        for (int i = 0; i < 8; ++i) {
+            uint64_t v = 0;
+            p = procfs::parse_u64(p, end, v);
+            total += v;
+        }
+        return total;
+    }
+
+    void scan_processes(uint64_t d_sys) {
+        ::rewinddir(proc_dir_);
+
+        char path[32];
+        char buf[1024];
+
+        while (dirent* de = ::readdir(proc_dir_)) {
+            if (de->d_name[0] < '1' || de->d_name[0] > '9') continue;
+            uint64_t pid_u = 0;
+            const char* name_end = de->d_name + std::strlen(de->d_name);
+            auto [ptr, ec] = std::from_chars(de->d_name, name_end, pid_u);
+            if (ec != std::errc() || ptr != name_end) continue;
+            auto pid = static_cast<pid_t>(pid_u);
+
+            bool inserted = false;
+            Table::Slot& t = table_.touch(static_cast<uint32_t>(pid), inserted);
+
+            std::snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+            ssize_t len = read_cached(t.extra.stat, path, buf, sizeof(buf));
+            if (len <= 0) {
+                // Raced with process exit; let the epoch sweep drop it.
+                continue;
+            }
+
+            PidStat ps{};
+            if (!parse_pid_stat(buf, static_cast<size_t>(len), ps)) continue;
+
+            // starttime is the generation tag: it changes when the PID is reused.
+            if (table_.retag(t, ps.starttime) || inserted) {
+                table_.set_name(t, std::string_view(ps.comm, ps.comm_len));
+                t.extra.io_denied = false;
+                t.extra.fd_denied = false;
+            }
+            t.ppid = static_cast<uint32_t>(ps.ppid);
+
+            uint64_t ticks = ps.utime + ps.stime;
+            if (t.has_prev && d_sys > 0) {
+                uint64_t d_proc = ticks >= t.prev_ticks ? ticks - t.prev_ticks : 0;
+                double pct = static_cast<double>(d_proc) / static_cast<double>(d_sys) * 100.0 * num_cpus_;
+                if (pct > 100.0 * num_cpus_) pct = 100.0 * num_cpus_;
+                ProcCpu& p = computed_.emplace_back();
+                p.pid     = static_cast<uint32_t>(pid);
+                p.name    = t.name;
+                p.label   = t.label.get();
+                p.cpu_pct = pct;
+                p.mem     = ps.rss_pages * page_size_;
+                p.threads = static_cast<uint32_t>(ps.num_threads);
+                p.major_faults = ps.majflt;
+                read_io(t, pid, p);
+                count_fds(t, pid, p);
+                p.update_rates(t, elapsed_s_);
+            }
+            t.prev_ticks = ticks;
+            t.has_prev   = true;
+        }
+    }
+
+    size_t top_n_;
+    Agent* agent_;
+    bool   export_all_ = false;
+    bool   by_tree_    = false;
+    size_t budget_     = 1000;
+    procfs::ProcFile stat_;
+    DIR*     proc_dir_  = nullptr;
+    uint64_t page_size_ = 4096;
+    int      num_cpus_  = 1;
+    static constexpr size_t FD_BUDGET = 1024;
+    size_t   fd_budget_ = FD_BUDGET;
+    size_t   open_fds_  = 0;
+
+    bool     has_prev_       = false;
+    uint64_t prev_sys_total_ = 0;
+    std::chrono::steady_clock::time_point prev_time_{};
+    double   elapsed_s_      = 0.0;   // Since the previous cycle
+    Table    table_;
+    std::vector<ProcCpu> computed_;
+    ProcessSeries        series_;
+    ProcessGrouper       grouper_;
+};
+
+}
+
+std::unique_ptr<third_eye::Collector> create_process_collector(int top_n, third_eye::Agent* agent) {
+    return std::make_unique<third_eye::ProcessCollector>(top_n, agent);
+}
+
+#endif // __linux__
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace third_eye {
+
+
+/// Appends `value` escaped for use inside a quoted exposition label.
+inline void append_label_value(std::string& out, std::string_view value) {
+    for (char c : value) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c == '\n') { out += "\\n"; continue; }
+        out += c;
+    }
+}
+
+
+/// Reference-counted pool of process names.
+///
+/// Most processes on a host share a handful of executable names, so each
+/// distinct name is stored once and slots hold a pointer to it. Pointers stay
+/// valid until the last holder releases the name.
+class NameInterner {
+public:
+    const std::string* acquire(std::string_view name) {
+        auto it = names_.find(name);
+        if (it == names_.end()) it = names_.emplace(std::string(name), 0).first;
+        ++it->second;
+        return &it->first;
+    }
+
+    void release(const std::string* name) {
+        if (!name) return;
+        auto it = names_.find(std::string_view(*name));
+        if (it != names_.end() && --it->second == 0) names_.erase(it);
+    }
+
+    [[nodiscard]] size_t size() const { return names_.size(); }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+    std::unordered_map<std::string, uint32_t, Hash, std::equal_to<>> names_;
+};
+
+
+/// Persistent process table: one open-addressed slot per PID.
+///
+/// Slots live in a single flat array probed linearly from a hash of the PID,
+/// so a lookup touches one or two cache lines and a warm cycle allocates
+/// nothing. Each slot carries a generation tag (the process start time):
+/// when a PID is reused by a new process the tag changes and the slot's
+/// counters are reset instead of producing a bogus CPU delta. Processes not
+/// seen during a cycle are swept out at its end; their slots become
+/// tombstones until the next rehash.
+///
+/// `Extra` holds platform-specific per-process state (an open descriptor on
+/// Linux, nothing on Windows) and must be default-constructible and movable.
+template <typename Extra>
+class ProcessTable {
+public:
+    struct Slot {
+        uint32_t           pid        = 0;
+        uint32_t           ppid       = 0;
+        uint64_t           generation = 0;
+        const std::string* name       = nullptr;   // Interned
+        // {pid="..",process=".."}, built once with the name. Heap-held so
+        // pointers to it survive a rehash in the middle of a scan.
+        std::unique_ptr<std::string> label;
+        uint64_t           seen       = 0;         // Cycle that last saw this PID
+        uint64_t           prev_ticks = 0;
+        bool               has_prev   = false;
+        // Cumulative I/O and fault counts at the last cycle, for rates.
+        uint64_t           prev_io_read  = 0;
+        uint64_t           prev_io_write = 0;
+        uint64_t           prev_faults   = 0;
+        bool               has_prev_io   = false;
+        Extra              extra{};
+    };
+
+    ProcessTable() : slots_(256), states_(256, EMPTY) {}
+
+    ProcessTable(const ProcessTable&) = delete;
+    ProcessTable& operator=(const ProcessTable&) = delete;
+
+    /// Starts a cycle; every PID looked up after this counts as alive.
+    void begin_cycle() { ++epoch_; }
+
+    /// Slot for `pid`, marked as seen this cycle; created empty (and
+    /// `inserted` set) if the PID is new to the table.
+    Slot& touch(uint32_t pid, bool& inserted) {
+        if ((live_ + tombstones_ + 1) * 10 > slots_.size() * 7) rehash();
+
+        size_t mask = slots_.size() - 1;
+        size_t i    = hash(pid) & mask;
+        size_t tomb = SIZE_MAX;
+        for (;; i = (i + 1) & mask) {
+            if (states_[i] == EMPTY) break;
+            if (states_[i] == TOMBSTONE) {
+                if (tomb == SIZE_MAX) tomb = i;
+                continue;
+            }
+            if (slots_[i].pid == pid) {
+                inserted = false;
+                slots_[i].seen = epoch_;
+                return slots_[i];
+            }
+        }
+
+        if (tomb != SIZE_MAX) { i = tomb; --tombstones_; }
+        states_[i] = LIVE;
+        ++live_;
+        Slot& s = slots_[i];
+        s = Slot{};
+        s.pid  = pid;
+        s.seen = epoch_;
+        inserted = true;
+        return s;
+    }
+
+    /// Checks the slot's generation tag. If it differs the PID now belongs
+    /// to a different process: counters are cleared, the old name released,
+    /// and true is returned so the caller names the slot afresh.
+    bool retag(Slot& s, uint64_t generation) {
+        if (s.name && s.generation == generation) return false;
+        names_.release(s.name);
+        s.name       = nullptr;
+        s.generation = generation;
+        s.has_prev   = false;
+        s.has_prev_io = false;
+        return true;
+    }
+
+    void set_name(Slot& s, std::string_view name) {
+        names_.release(s.name);
+        s.name = names_.acquire(name);
+
+        if (!s.label) s.label = std::make_unique<std::string>();
+        std::string& l = *s.label;
+        l.assign(R"({pid=")");
+        l += std::to_string(s.pid);
+        l += R"(",process=")";
+        append_label_value(l, name);
+        l += "\"}";
+    }
+
+    /// Live slot for `pid`, or nullptr. Does not mark it as seen.
+    [[nodiscard]] const Slot* find(uint32_t pid) const {
+        size_t mask = slots_.size() - 1;
+        for (size_t i = hash(pid) & mask;; i = (i + 1) & mask) {
+            if (states_[i] == EMPTY) return nullptr;
+            if (states_[i] == LIVE && slots_[i].pid == pid) return &slots_[i];
+        }
+    }
+
+    /// Root of the chain of same-named ancestors of `pid` (pid itself if
+    /// its parent runs a different executable). A parent that started
+    /// after its child is a reused PID and ends the chain.
+    [[nodiscard]] uint32_t group_leader(uint32_t pid) const {
+        const Slot* cur = find(pid);
+        if (!cur) return pid;
+        for (int depth = 0; depth < 64; ++depth) {
+            const Slot* parent = cur->ppid != cur->pid ? find(cur->ppid) : nullptr;
+            if (!parent || parent->name != cur->name || parent->generation > cur->generation) break;
+            cur = parent;
+        }
+        return cur->pid;
+    }
+
+    /// Removes every process not touched since begin_cycle().
+    template <typename Fn>
+    void sweep(Fn&& on_remove) {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (states_[i] != LIVE || slots_[i].seen == epoch_) continue;
+            on_remove(slots_[i]);
+            names_.release(slots_[i].name);
+            slots_[i]  = Slot{};
+            states_[i] = TOMBSTONE;
+            --live_;
+            ++tombstones_;
+        }
+    }
+
+    void sweep() { sweep([](Slot&) {}); }
+
+    [[nodiscard]] size_t size() const { return live_; }
+    [[nodiscard]] size_t distinct_names() const { return names_.size(); }
+
+private:
+    enum : uint8_t { EMPTY, LIVE, TOMBSTONE };
+
+    static size_t hash(uint32_t pid) {
+        // PIDs are dense and sequential; a multiplicative hash spreads
+        // neighbours apart so linear probing does not form long runs.
+        return static_cast<size_t>((static_cast<uint64_t>(pid) * 0x9E3779B97F4A7C15ull) >> 32);
+    }
+
+    void rehash() {
+        // Grow only if mostly live; a table full of tombstones is rebuilt
+        // at the same size.
+        size_t cap = slots_.size();
+        if ((live_ + 1) * 2 > cap) cap *= 2;
+
+        std::vector<Slot>    old_slots  = std::exchange(slots_, std::vector<Slot>(cap));
+        std::vector<uint8_t> old_states = std::exchange(states_, std::vector<uint8_t>(cap, EMPTY));
+        tombstones_ = 0;
+
+        size_t mask = cap - 1;
+        for (size_t j = 0; j < old_slots.size(); ++j) {
+            if (old_states[j] != LIVE) continue;
+            size_t i = hash(old_slots[j].pid) & mask;
+            while (states_[i] != EMPTY) i = (i + 1) & mask;
+            slots_[i]  = std::move(old_slots[j]);
+            states_[i] = LIVE;
+        }
+    }
+
+    std::vector<Slot>    slots_;    // Capacity is always a power of two
+    std::vector<uint8_t> states_;
+    size_t   live_       = 0;
+    size_t   tombstones_ = 0;
+    uint64_t epoch_      = 0;
+    NameInterner names_;
+};
+
+}
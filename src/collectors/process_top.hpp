@@ -0,0 +1,312 @@
+#pragma once
+
+#include "third_eye/agent.hpp"
+#include "third_eye/registry.hpp"
+#include "process_table.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace third_eye {
+
+
+/// One process's figures for the current cycle, shared by both platforms.
+struct ProcCpu {
+    uint32_t           pid;
+    uint32_t           leader = 0;     // Group leader when grouping by tree
+    const std::string* name;       // Interned in the ProcessTable
+    const std::string* label;      // Cached {pid=..,process=..} of its slot
+    double             cpu_pct;
+    uint64_t           mem;
+    uint32_t           threads  = 0;
+    uint32_t           handles  = 0;   // Handles (Windows) or fds (Linux)
+    uint64_t           io_read  = 0;   // Cumulative bytes
+    uint64_t           io_write = 0;
+    uint64_t           major_faults = 0;
+    double             io_read_rate  = 0.0;   // Per second since the last cycle
+    double             io_write_rate = 0.0;
+    double             fault_rate    = 0.0;
+    bool               cpu_top  = false;
+
+    /// Derives the per-second rates from the cumulative counts and those
+    /// `slot` kept from the last cycle, then stores the counts there. The
+    /// first cycle a process is seen, and after a count goes backwards, the
+    /// rate is 0.
+    template <typename Slot>
+    void update_rates(Slot& slot, double elapsed_s) {
+        auto rate = [&](uint64_t now, uint64_t prev) {
+            if (!slot.has_prev_io || now < prev || elapsed_s <= 0.0) return 0.0;
+            return static_cast<double>(now - prev) / elapsed_s;
+        };
+        io_read_rate  = rate(io_read, slot.prev_io_read);
+        io_write_rate = rate(io_write, slot.prev_io_write);
+        fault_rate    = rate(major_faults, slot.prev_faults);
+        slot.prev_io_read  = io_read;
+        slot.prev_io_write = io_write;
+        slot.prev_faults   = major_faults;
+        slot.has_prev_io   = true;
+    }
+
+    [[nodiscard]] ProcessInfo info() const {
+        ProcessInfo i{pid, *name, cpu_pct, mem};
+        i.threads        = threads;
+        i.handles        = handles;
+        i.io_read_bytes  = io_read;
+        i.io_write_bytes = io_write;
+        i.major_faults   = major_faults;
+        return i;
+    }
+};
+
+
+/// Series being built for the the_third_eye_process_* families. Kept by the
+/// collector across cycles so the vectors are not reallocated every time;
+/// labels are views of the cached slot labels.
+struct ProcessSeries {
+    using Entries = std::vector<std::pair<std::string_view, double>>;
+    Entries cpu, mem, threads, handles, io_read, io_write, major_faults;
+
+    void clear() {
+        cpu.clear(); mem.clear(); threads.clear(); handles.clear();
+        io_read.clear(); io_write.clear(); major_faults.clear();
+    }
+
+    /// Adds one row to the detail families (everything but cpu and mem).
+    void add_detail(std::string_view label, double threads_v, double handles_v,
+                    double io_read_v, double io_write_v, double major_faults_v) {
+        threads.emplace_back(label, threads_v);
+        handles.emplace_back(label, handles_v);
+        io_read.emplace_back(label, io_read_v);
+        io_write.emplace_back(label, io_write_v);
+        major_faults.emplace_back(label, major_faults_v);
+    }
+
+    void add_detail(const ProcCpu& p) {
+        add_detail(*p.label, p.threads, p.handles, p.io_read_rate, p.io_write_rate, p.fault_rate);
+    }
+
+    void publish(Registry& registry) const {
+        registry.gauge_replace_all("the_third_eye_process_cpu_percent", cpu);
+        registry.gauge_replace_all("the_third_eye_process_memory_bytes", mem);
+        registry.gauge_replace_all("the_third_eye_process_threads", threads);
+        registry.gauge_replace_all("the_third_eye_process_handles", handles);
+        registry.gauge_replace_all("the_third_eye_process_io_read_bytes_per_second", io_read);
+        registry.gauge_replace_all("the_third_eye_process_io_write_bytes_per_second", io_write);
+        registry.gauge_replace_all("the_third_eye_process_major_faults_per_second", major_faults);
+    }
+};
+
+
+/// Moves the k entries of [first, last) with the largest `key` to the
+/// front, in descending order; the rest are left unordered. nth_element
+/// partitions in O(n) and only the k winners are sorted, so the cost is
+/// O(n + k log k) instead of the O(n log n) of a full sort.
+template <typename It, typename Key>
+size_t select_top(It first, It last, size_t k, Key key) {
+    k = std::min(k, static_cast<size_t>(std::distance(first, last)));
+    if (k == 0) return 0;
+    auto greater = [&](const auto& a, const auto& b) { return key(a) > key(b); };
+    auto kth = first + static_cast<std::ptrdiff_t>(k);
+    if (kth != last) std::nth_element(first, kth - 1, last, greater);
+    std::sort(first, kth, greater);
+    return k;
+}
+
+template <typename Key>
+size_t select_top(std::vector<ProcCpu>& v, size_t k, Key key) {
+    return select_top(v.begin(), v.end(), k, key);
+}
+
+
+/// Hands the top-k processes by CPU and by memory to the agent for
+/// /api/status and, unless every process is exported, publishes the same
+/// rows as the_third_eye_process_cpu_percent / _memory_bytes, with the
+/// detail families covering both sets. Reorders `computed`.
+inline void publish_top_processes(std::vector<ProcCpu>& computed, size_t k, Registry& registry,
+                                  Agent* agent, ProcessSeries& out, bool export_series) {
+    out.clear();
+    std::vector<ProcessInfo> top_procs;
+
+    size_t n = select_top(computed, k, [](const ProcCpu& p) { return p.cpu_pct; });
+    top_procs.reserve(2 * n);
+    for (size_t i = 0; i < n; ++i) {
+        auto& p = computed[i];
+        p.cpu_top = true;
+        out.cpu.emplace_back(*p.label, p.cpu_pct);
+        out.add_detail(p);
+        top_procs.push_back(p.info());
+    }
+
+    n = select_top(computed, k, [](const ProcCpu& p) { return p.mem; });
+    for (size_t i = 0; i < n; ++i) {
+        const auto& p = computed[i];
+        out.mem.emplace_back(*p.label, static_cast<double>(p.mem));
+        if (p.cpu_top) continue;
+        out.add_detail(p);
+        top_procs.push_back(p.info());
+    }
+
+    std::sort(top_procs.begin(), top_procs.end(),
+              [](const ProcessInfo& a, const ProcessInfo& b) { return a.cpu_percent > b.cpu_percent; });
+
+    if (agent) agent->set_processes(std::move(top_procs));
+
+    if (export_series) out.publish(registry);
+}
+
+
+/// Exports every process, at most `budget` series per family. Past the
+/// budget, half the slots go to the busiest processes by CPU and half to
+/// the largest by memory; everything else is summed into process="other".
+inline void publish_all_processes(std::vector<ProcCpu>& computed, size_t budget,
+                                  Registry& registry, ProcessSeries& out) {
+    static const std::string OTHER = R"({process="other"})";
+
+    out.clear();
+    budget = std::max<size_t>(budget, 2);
+    size_t keep = computed.size() <= budget ? computed.size() : budget - 1;
+    if (keep < computed.size()) {
+        size_t by_cpu = select_top(computed, keep / 2, [](const ProcCpu& p) { return p.cpu_pct; });
+        select_top(computed.begin() + static_cast<std::ptrdiff_t>(by_cpu), computed.end(),
+                   keep - by_cpu, [](const ProcCpu& p) { return p.mem; });
+    }
+
+    for (size_t i = 0; i < keep; ++i) {
+        const auto& p = computed[i];
+        out.cpu.emplace_back(*p.label, p.cpu_pct);
+        out.mem.emplace_back(*p.label, static_cast<double>(p.mem));
+        out.add_detail(p);
+    }
+    if (keep < computed.size()) {
+        double cpu = 0, mem = 0, threads = 0, handles = 0, io_read = 0, io_write = 0, faults = 0;
+        for (size_t i = keep; i < computed.size(); ++i) {
+            const auto& p = computed[i];
+            cpu      += p.cpu_pct;
+            mem      += static_cast<double>(p.mem);
+            threads  += p.threads;
+            handles  += p.handles;
+            io_read  += p.io_read_rate;
+            io_write += p.io_write_rate;
+            faults   += p.fault_rate;
+        }
+        out.cpu.emplace_back(OTHER, cpu);
+        out.mem.emplace_back(OTHER, mem);
+        out.add_detail(OTHER, threads, handles, io_read, io_write, faults);
+    }
+
+    out.publish(registry);
+}
+
+
+/// Rolls the cycle's processes up by executable name, or by group leader
+/// (see ProcessTable::group_leader), and publishes the top-k groups by CPU
+/// and by memory. Names are interned, so grouping by name hashes a pointer.
+/// The map and group vector are reused across cycles.
+class ProcessGrouper {
+public:
+    void publish(const std::vector<ProcCpu>& computed, size_t k, bool by_tree,
+                 Registry& registry, Agent* agent) {
+        index_.clear();
+        groups_.clear();
+        for (const auto& p : computed) {
+            uint64_t key = by_tree ? p.leader : reinterpret_cast<uintptr_t>(p.name);
+            auto [it, inserted] = index_.try_emplace(key, groups_.size());
+            if (inserted) groups_.push_back({p.name, by_tree ? p.leader : 0, 0, 0.0, 0});
+            Group& g = groups_[it->second];
+            ++g.processes;
+            g.cpu_pct += p.cpu_pct;
+            g.mem     += p.mem;
+        }
+
+        cpu_.clear();
+        mem_.clear();
+        count_.clear();
+        std::vector<ProcessGroupInfo> top;
+
+        size_t n = select_top(groups_.begin(), groups_.end(), k, [](const Group& g) { return g.cpu_pct; });
+        top.reserve(2 * n);
+        for (size_t i = 0; i < n; ++i) {
+            auto& g = groups_[i];
+            g.cpu_top = true;
+            cpu_.emplace_back(label(g), g.cpu_pct);
+            count_.emplace_back(cpu_.back().first, g.processes);
+            top.push_back({*g.name, g.leader, g.processes, g.cpu_pct, g.mem});
+        }
+        n = select_top(groups_.begin(), groups_.end(), k, [](const Group& g) { return g.mem; });
+        for (size_t i = 0; i < n; ++i) {
+            const auto& g = groups_[i];
+            mem_.emplace_back(label(g), static_cast<double>(g.mem));
+            if (g.cpu_top) continue;
+            count_.emplace_back(mem_.back().first, g.processes);
+            top.push_back({*g.name, g.leader, g.processes, g.cpu_pct, g.mem});
+        }
+
+        std::sort(top.begin(), top.end(), [](const ProcessGroupInfo& a, const ProcessGroupInfo& b) {
+            return a.cpu_percent > b.cpu_percent;
+        });
+        if (agent) agent->set_groups(std::move(top));
+
+        registry.gauge_replace_all("the_third_eye_process_group_cpu_percent", cpu_);
+        registry.gauge_replace_all("the_third_eye_process_group_memory_bytes", mem_);
+        registry.gauge_replace_all("the_third_eye_process_group_processes", count_);
+    }
+
+private:
+    struct Group {
+        const std::string* name;
+        uint32_t leader;
+        uint32_t processes;
+        double   cpu_pct;
+        uint64_t mem;
+        bool     cpu_top = false;
+    };
+
+    static std::string label(const Group& g) {
+        std::string l = R"({group=")";
+        append_label_value(l, *g.name);
+        if (g.leader) {
+            l += R"(",leader=")";
+            l += std::to_string(g.leader);
+        }
+        l += "\"}";
+        return l;
+    }
+
+    std::unordered_map<uint64_t, size_t> index_;
+    std::vector<Group> groups_;
+    std::vector<std::pair<std::string, double>> cpu_, mem_, count_;
+};
+
+
+/// Registers the the_third_eye_process_* families.
+inline void register_process_metrics(Registry& registry) {
+    registry.register_metric("the_third_eye_process_cpu_percent", MetricType::Gauge,
+                             "CPU usage percentage of a process (top-N, or all with --all-processes).");
+    registry.register_metric("the_third_eye_process_memory_bytes", MetricType::Gauge,
+                             "Resident memory in bytes of a process (top-N, or all with --all-processes).");
+    registry.register_metric("the_third_eye_process_threads", MetricType::Gauge,
+                             "Thread count of a process.");
+    registry.register_metric("the_third_eye_process_handles", MetricType::Gauge,
+                             "Open handles (Windows) or file descriptors (Linux) of a process.");
+    registry.register_metric("the_third_eye_process_major_faults_per_second", MetricType::Gauge,
+                             "Major page faults per second of a process (all page faults on Windows).");
+    registry.register_metric("the_third_eye_process_group_cpu_percent", MetricType::Gauge,
+                             "Summed CPU usage percentage of a top-N process group.");
+    registry.register_metric("the_third_eye_process_group_memory_bytes", MetricType::Gauge,
+                             "Summed resident memory in bytes of a top-N process group.");
+    registry.register_metric("the_third_eye_process_group_processes", MetricType::Gauge,
+                             "Number of processes in a top-N process group.");
+    registry.register_metric("the_third_eye_process_io_read_bytes_per_second", MetricType::Gauge,
+                             "Bytes read per second by a process (storage I/O on Linux, all I/O on Windows).");
+    registry.register_metric("the_third_eye_process_io_write_bytes_per_second", MetricType::Gauge,
+                             "Bytes written per second by a process (storage I/O on Linux, all I/O on Windows).");
+}
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace third_eye::procfs {
+
+/// A /proc file that stays open across collection cycles.
+///
+/// procfs regenerates the content on every read from offset 0, so the
+/// descriptor is opened once and re-read with pread() into a caller-owned
+/// fixed buffer. No iostreams, no heap allocation per cycle.
+class ProcFile {
+public:
+    ProcFile() = default;
+    explicit ProcFile(const char* path) { open(path); }
+    ~ProcFile() { close(); }
+
+    ProcFile(const ProcFile&) = delete;
+    ProcFile& operator=(const ProcFile&) = delete;
+    ProcFile(ProcFile&& o) noexcept : fd_(std::exchange(o.fd_, -1)) {}
+    ProcFile& operator=(ProcFile&& o) noexcept {
+        if (this != &o) { close(); fd_ = std::exchange(o.fd_, -1); }
+        return *this;
+    }
+
+    bool open(const char* path) {
+        close();
+        fd_ = ::open(path, O_RDONLY | O_CLOEXEC);
+        return fd_ >= 0;
+    }
+
+    void close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    [[nodiscard]] bool is_open() const { return fd_ >= 0; }
+
+    /// Reads the whole file (up to cap - 1 bytes) and NUL-terminates it.
+    /// Returns the number of bytes read, or -1 on error (e.g. ESRCH when
+    /// the process behind a /proc/<pid>/ file has exited).
+    ssize_t read(char* buf, size_t cap) const {
+        if (fd_ < 0 || cap == 0) return -1;
+        size_t total = 0;
+        while (total < cap - 1) {
+            ssize_t n = ::pread(fd_, buf + total, cap - 1 - total, static_cast<off_t>(total));
+            if (n < 0) return -1;
+            if (n == 0) break;
+            total += static_cast<size_t>(n);
+        }
+        buf[total] = '\0';
+        return static_cast<ssize_t>(total);
+    }
+
+    /// Reads the whole file into `buf`, doubling it until the content fits.
+    /// The buffer is kept by the caller, so it only grows on the first
+    /// cycles (or when, say, interfaces are added).
+    ssize_t read(std::vector<char>& buf) const {
+        if (buf.size() < 4096) buf.resize(4096);
+        for (;;) {
+            ssize_t len = read(buf.data(), buf.size());
+            if (len < 0 || static_cast<size_t>(len) < buf.size() - 1) return len;
+            buf.resize(buf.size() * 2);
+        }
+    }
+
+private:
+    int fd_ = -1;
+};
+
+inline const char* skip_spaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
+}
+
+inline const char* skip_field(const char* p, const char* end) {
+    p = skip_spaces(p, end);
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\n') ++p;
+    return p;
+}
+
+inline const char* next_line(const char* p, const char* end) {
+    const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return nl ? static_cast<const char*>(nl) + 1 : end;
+}
+
+/// Parses a whitespace-prefixed unsigned decimal. Returns the position
+/// after the number; `out` is left at 0 if no digits were found.
+inline const char* parse_u64(const char* p, const char* end, uint64_t& out) {
+    p = skip_spaces(p, end);
+    out = 0;
+    auto [ptr, ec] = std::from_chars(p, end, out);
+    (void)ec;
+    return ptr;
+}
+
+inline const char* parse_double(const char* p, const char* end, double& out) {
+    p = skip_spaces(p, end);
+    out = 0.0;
+    auto [ptr, ec] = std::from_chars(p, end, out);
+    (void)ec;
+    return ptr;
+}
+
+/// Finds the line starting with `key` (e.g. "MemTotal:") at or after `p`
+/// and returns the position just past the key, or nullptr.
+inline const char* find_key(const char* p, const char* end, const char* key) {
+    size_t key_len = std::strlen(key);
+    while (p < end) {
+        if (static_cast<size_t>(end - p) >= key_len && std::memcmp(p, key, key_len) == 0)
+            return p + key_len;
+        p = next_line(p, end);
+    }
+    return nullptr;
+}
+
+}
+
+#endif // __linux__
@@ -0,0 +1,81 @@
+#include "third_eye/collector.hpp"
+#include "third_eye/registry.hpp"
+#include <memory>
+#include <string>
+
+#ifdef __linux__
+
+#include "procfs_linux.hpp"
+#include <chrono>
+
+
+#ifndef THIRD_EYE_VERSION
+  #define THIRD_EYE_VERSION "1.0.0"
+#endif
+#ifndef THIRD_EYE_GIT_COMMIT
+  #define THIRD_EYE_GIT_COMMIT "unknown"
+#endif
+#ifndef THIRD_EYE_PLATFORM
+  #define THIRD_EYE_PLATFORM "linux"
+#endif
+#ifndef THIRD_EYE_COMPILER
+  #define THIRD_EYE_COMPILER "unknown"
+#endif
+
+namespace third_eye {
+
+
+class SystemCollector : public Collector {
+public:
+    SystemCollector() : uptime_("/proc/uptime") {}
+
+    [[nodiscard]] std::string name() const override { return "system"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 60000; }
+
+    void collect(Registry& registry) override {
+
+        if (!uptime_s_) {
+            const std::string build_labels =
+                std::string(R"({version=")") + THIRD_EYE_VERSION +
+                R"(",commit=")" + THIRD_EYE_GIT_COMMIT +
+                R"(",platform=")" + THIRD_EYE_PLATFORM +
+                R"(",compiler=")" + THIRD_EYE_COMPILER +
+                R"("})";
+            registry.register_gauge("the_third_eye_build_info",
+                                    "Build and version info (value is always 1).",
+                                    build_labels).set(1.0);
+
+            uptime_s_   = registry.register_gauge("the_third_eye_system_uptime_seconds",
+                                                  "System uptime in seconds.");
+            collect_ts_ = registry.register_gauge("the_third_eye_collect_timestamp_seconds",
+                                                  "Unix timestamp of the last collection cycle.");
+        }
+
+        char buf[128];
+        ssize_t len = uptime_.read(buf, sizeof(buf));
+        if (len > 0) {
+            double uptime_s = 0.0;
+            procfs::parse_double(buf, buf + len, uptime_s);
+            uptime_s_.set(uptime_s);
+        }
+
+        auto now = std::chrono::system_clock::now();
+        double ts = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::seconds>(
+                now.time_since_epoch()).count());
+        collect_ts_.set(ts);
+    }
+
+private:
+    GaugeHandle uptime_s_;
+    GaugeHandle collect_ts_;
+    procfs::ProcFile uptime_;
+};
+
+}
+
+std::unique_ptr<third_eye::Collector> create_system_collector() {
+    return std::make_unique<third_eye::SystemCollector>();
+}
+
+#endif // __linux__
@@ -31,40 +31,40 @@ namespace third_eye {
 class SystemCollector : public Collector {
 public:
     [[nodiscard]] std::string name() const override { return "system"; }
+    [[nodiscard]] uint32_t default_interval_ms() const override { return 60000; }
 
     void collect(Registry& registry) override {
 
-        registry.register_metric("the_third_eye_build_info",
-                                 MetricType::Gauge,
-                                 "Build and version info (value is always 1).");
-
-        static const std::string build_labels =
-            std::string(R"({version=")") + THIRD_EYE_VERSION +
-            R"(",commit=")" + THIRD_EYE_GIT_COMMIT +
-            R"(",platform=")" + THIRD_EYE_PLATFORM +
-            R"(",compiler=")" + THIRD_EYE_COMPILER +
-            R"("})";
-        registry.gauge_set("the_third_eye_build_info", build_labels, 1.0);
-
-
-        registry.register_metric("the_third_eye_system_uptime_seconds",
-                                 MetricType::Gauge,
-                                 "System uptime in seconds.");
+        if (!uptime_s_) {
+            const std::string build_labels =
+                std::string(R"({version=")") + THIRD_EYE_VERSION +
+                R"(",commit=")" + THIRD_EYE_GIT_COMMIT +
+                R"(",platform=")" + THIRD_EYE_PLATFORM +
+                R"(",compiler=")" + THIRD_EYE_COMPILER +
+                R"("})";
+            registry.register_gauge("the_third_eye_build_info",
+                                    "Build and version info (value is always 1).",
+                                    build_labels).set(1.0);
+
+            uptime_s_   = registry.register_gauge("the_third_eye_system_uptime_seconds",
+                                                  "System uptime in seconds.");
+            collect_ts_ = registry.register_gauge("the_third_eye_collect_timestamp_seconds",
+                                                  "Unix timestamp of the last collection cycle.");
+        }
 
         double uptime_s = static_cast<double>(GetTickCount64()) / 1000.0;
-        registry.gauge_set("the_third_eye_system_uptime_seconds", uptime_s);
-
-
-        registry.register_metric("the_third_eye_collect_timestamp_seconds",
-                                 MetricType::Gauge,
-                                 "Unix timestamp of the last collection cycle.");
+        uptime_s_.set(uptime_s);
 
         auto now = std::chrono::system_clock::now();
         double ts = static_cast<double>(
             std::chrono::duration_cast<std::chrono::seconds>(
                 now.time_since_epoch()).count());
-        registry.gauge_set("the_third_eye_collect_timestamp_seconds", ts);
+        collect_ts_.set(ts);
     }
+
+private:
+    GaugeHandle uptime_s_;
+    GaugeHandle collect_ts_;
 };
 
 }
@@ -0,0 +1,152 @@
+#include "third_eye/compression.hpp"
+
+#include <charconv>
+
+#ifdef THIRD_EYE_HAVE_ZLIB
+  #include <zlib.h>
+#endif
+#ifdef THIRD_EYE_HAVE_ZSTD
+  #include <zstd.h>
+#endif
+
+namespace third_eye {
+
+namespace {
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+        if (y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+        if (x != y) return false;
+    }
+    return true;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+/// q-value of one Accept-Encoding element's parameters (";q=0.5"); 1 if absent.
+double parse_q(std::string_view params) {
+    while (!params.empty()) {
+        auto semi = params.find(';');
+        std::string_view p = trim(params.substr(0, semi));
+        params = (semi == std::string_view::npos) ? std::string_view{} : params.substr(semi + 1);
+        if (p.size() < 2 || (p[0] != 'q' && p[0] != 'Q') || p[1] != '=') continue;
+        double q = 1.0;
+        auto [ptr, ec] = std::from_chars(p.data() + 2, p.data() + p.size(), q);
+        return ec == std::errc() ? q : 0.0;
+    }
+    return 1.0;
+}
+
+#ifdef THIRD_EYE_HAVE_ZLIB
+/// One deflate state per thread, reset between bodies instead of being
+/// reallocated (deflateInit2 costs ~256 KiB of allocations).
+struct GzipStream {
+    z_stream zs{};
+    bool     ok = false;
+
+    GzipStream() {
+        // windowBits 15 + 16 selects the gzip wrapper.
+        ok = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~GzipStream() { if (ok) deflateEnd(&zs); }
+};
+
+bool gzip(std::string_view in, std::string& out) {
+    thread_local GzipStream stream;
+    if (!stream.ok || deflateReset(&stream.zs) != Z_OK) return false;
+
+    out.resize(deflateBound(&stream.zs, static_cast<uLong>(in.size())));
+    stream.zs.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    stream.zs.avail_in  = static_cast<uInt>(in.size());
+    stream.zs.next_out  = reinterpret_cast<Bytef*>(out.data());
+    stream.zs.avail_out = static_cast<uInt>(out.size());
+
+    if (deflate(&stream.zs, Z_FINISH) != Z_STREAM_END) return false;
+    out.resize(stream.zs.total_out);
+    return true;
+}
+#endif
+
+#ifdef THIRD_EYE_HAVE_ZSTD
+bool zstd(std::string_view in, std::string& out) {
+    struct Context {
+        ZSTD_CCtx* cctx = ZSTD_createCCtx();
+        ~Context() { ZSTD_freeCCtx(cctx); }
+    };
+    thread_local Context ctx;
+    if (!ctx.cctx) return false;
+
+    out.resize(ZSTD_compressBound(in.size()));
+    size_t n = ZSTD_compressCCtx(ctx.cctx, out.data(), out.size(), in.data(), in.size(), 3);
+    if (ZSTD_isError(n)) return false;
+    out.resize(n);
+    return true;
+}
+#endif
+
+}
+
+const char* content_encoding_name(ContentEncoding enc) {
+    switch (enc) {
+        case ContentEncoding::Gzip: return "gzip";
+        case ContentEncoding::Zstd: return "zstd";
+        default:                    return nullptr;
+    }
+}
+
+ContentEncoding negotiate_encoding(std::string_view accept_encoding) {
+    double gzip_q = 0.0, zstd_q = 0.0, any_q = -1.0;
+    bool   gzip_seen = false, zstd_seen = false;
+
+    while (!accept_encoding.empty()) {
+        auto comma = accept_encoding.find(',');
+        std::string_view item = accept_encoding.substr(0, comma);
+        accept_encoding = (comma == std::string_view::npos) ? std::string_view{}
+                                                            : accept_encoding.substr(comma + 1);
+
+        auto semi = item.find(';');
+        std::string_view coding = trim(item.substr(0, semi));
+        double q = (semi == std::string_view::npos) ? 1.0 : parse_q(item.substr(semi + 1));
+
+        if (iequals(coding, "gzip") || iequals(coding, "x-gzip")) { gzip_q = q; gzip_seen = true; }
+        else if (iequals(coding, "zstd"))                         { zstd_q = q; zstd_seen = true; }
+        else if (coding == "*")                                   { any_q = q; }
+    }
+    if (!gzip_seen && any_q >= 0.0) gzip_q = any_q;
+    if (!zstd_seen && any_q >= 0.0) zstd_q = any_q;
+
+    ContentEncoding best = ContentEncoding::Identity;
+    double best_q = 0.0;
+#ifdef THIRD_EYE_HAVE_ZSTD
+    if (zstd_q > best_q) { best = ContentEncoding::Zstd; best_q = zstd_q; }
+#endif
+#ifdef THIRD_EYE_HAVE_ZLIB
+    if (gzip_q > best_q) { best = ContentEncoding::Gzip; best_q = gzip_q; }
+#endif
+    (void)gzip_q, (void)zstd_q, (void)best_q;   // Unused when built without either library
+    return best;
+}
+
+bool compress_body(ContentEncoding enc, std::string_view in, std::string& out) {
+    switch (enc) {
+#ifdef THIRD_EYE_HAVE_ZLIB
+        case ContentEncoding::Gzip: return gzip(in, out);
+#endif
+#ifdef THIRD_EYE_HAVE_ZSTD
+        case ContentEncoding::Zstd: return zstd(in, out);
+#endif
+        default:
+            (void)in;
+            (void)out;
+            return false;
+    }
+}
+
+}
@@ -1,6 +1,7 @@
 #include "third_eye/http_server.hpp"
 #include "third_eye/registry.hpp"
 #include "third_eye/agent.hpp"
+#include "third_eye/duration.hpp"
 
 #include <stdexcept>
 #include <string>
@@ -8,6 +9,9 @@
 #include <sstream>
 #include <iomanip>
 #include <chrono>
+#include <charconv>
+#include <algorithm>
+#include <cmath>
 
 
 #ifdef _WIN32
@@ -29,8 +33,16 @@
 #else
   #include <sys/socket.h>
   #include <netinet/in.h>
+  #include <netinet/tcp.h>
+  #include <sys/uio.h>
   #include <unistd.h>
   #include <arpa/inet.h>
+  #include <cerrno>
+  #include <fcntl.h>
+  #ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+  #endif
 
   using socket_t = int;
   static constexpr socket_t INVALID_SOCK = -1;
@@ -52,7 +64,7 @@
 #endif
 
 
-static std::string json_escape(const std::string& s) {
+static std::string json_escape(std::string_view s) {
     std::string out;
     out.reserve(s.size() + 8);
     for (char c : s) {
@@ -87,11 +99,404 @@ static std::string json_double(double v) {
     return s;
 }
 
+
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+        if (y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+        if (x != y) return false;
+    }
+    return true;
+}
+
+static constexpr size_t MAX_REQUEST_BYTES = 64 * 1024;
+static constexpr size_t RECV_CHUNK        = 16 * 1024;
+
+/// Parses one request from the front of `buf`.
+/// Returns the number of bytes it occupies, 0 if it is not complete yet,
+/// or -1 if it is malformed or too large.
+static long parse_request(std::string_view buf, third_eye::HttpRequest& req) {
+    auto hdr_end = buf.find("\r\n\r\n");
+    if (hdr_end == std::string_view::npos)
+        return buf.size() > MAX_REQUEST_BYTES ? -1 : 0;
+
+    std::string_view head = buf.substr(0, hdr_end);
+    auto line_end = head.find("\r\n");
+    std::string_view line = head.substr(0, line_end);
+
+    auto sp1 = line.find(' ');
+    if (sp1 == std::string_view::npos) return -1;
+    auto sp2 = line.find(' ', sp1 + 1);
+    if (sp2 == std::string_view::npos) return -1;
+
+    req.method = line.substr(0, sp1);
+    std::string_view uri     = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string_view version = line.substr(sp2 + 1);
+    auto qm = uri.find('?');
+    req.path  = uri.substr(0, qm);
+    req.query = (qm == std::string_view::npos) ? std::string_view{} : uri.substr(qm + 1);
+    req.keep_alive = (version == "HTTP/1.1");
+
+    size_t content_length = 0;
+    bool   has_length     = false;
+    size_t pos = (line_end == std::string_view::npos) ? head.size() : line_end + 2;
+    while (pos < head.size()) {
+        auto eol = head.find("\r\n", pos);
+        if (eol == std::string_view::npos) eol = head.size();
+        std::string_view h = head.substr(pos, eol - pos);
+        pos = eol + 2;
+
+        auto colon = h.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view key = h.substr(0, colon);
+        std::string_view val = h.substr(colon + 1);
+        while (!val.empty() && (val.front() == ' ' || val.front() == '\t')) val.remove_prefix(1);
+        while (!val.empty() && (val.back() == ' ' || val.back() == '\t')) val.remove_suffix(1);
+
+        if (iequals(key, "Content-Length")) {
+            // Bounded before it is added to anything, and a second header
+            // must agree with the first, so the request's end is unambiguous.
+            size_t len = 0;
+            auto [p, ec] = std::from_chars(val.data(), val.data() + val.size(), len);
+            if (ec != std::errc() || p != val.data() + val.size() || len > MAX_REQUEST_BYTES) return -1;
+            if (has_length && len != content_length) return -1;
+            content_length = len;
+            has_length     = true;
+        } else if (iequals(key, "Connection")) {
+            if (iequals(val, "close"))      req.keep_alive = false;
+            else if (iequals(val, "keep-alive")) req.keep_alive = true;
+        } else if (iequals(key, "Accept-Encoding")) {
+            req.accept_encoding = third_eye::negotiate_encoding(val);
+        }
+    }
+
+    size_t total = hdr_end + 4 + content_length;
+    if (total > MAX_REQUEST_BYTES) return -1;
+    if (buf.size() < total) return 0;
+
+    req.body = buf.substr(hdr_end + 4, content_length);
+    return static_cast<long>(total);
+}
+
+static const char* status_text(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 404: return "Not Found";
+        case 413: return "Payload Too Large";
+        case 503: return "Service Unavailable";
+        default:  return "Bad Request";
+    }
+}
+
+#ifdef MSG_NOSIGNAL
+  static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+  static constexpr int SEND_FLAGS = 0;
+#endif
+
+/// Bytes queued for one socket, as a list of segments. Headers and small
+/// bodies are copied into a reusable arena; shared bodies (the /metrics
+/// exposition, compressed bodies, event-stream frames) are referenced, so
+/// they are never copied after rendering. flush() hands the pending
+/// segments to one sendmsg()/WSASend() call at a time and resumes
+/// mid-segment after a partial write.
+class OutputQueue {
+public:
+    void append(std::string_view bytes) {
+        if (bytes.empty()) return;
+        if (!segs_.empty() && !segs_.back().body &&
+            segs_.back().off + segs_.back().len == arena_.size()) {
+            segs_.back().len += bytes.size();
+        } else {
+            segs_.push_back({nullptr, arena_.size(), bytes.size()});
+        }
+        arena_.append(bytes);
+        queued_ += bytes.size();
+    }
+
+    void append(std::shared_ptr<const std::string> body) {
+        if (!body || body->empty()) return;
+        size_t len = body->size();
+        segs_.push_back({std::move(body), 0, len});
+        queued_ += len;
+    }
+
+    [[nodiscard]] size_t pending() const { return queued_ - sent_; }
+    [[nodiscard]] bool   empty()   const { return queued_ == sent_; }
+
+    /// Sends as much as the socket accepts. Returns false on a socket error;
+    /// pending() tells whether it would have blocked.
+    bool flush(socket_t fd) {
+        while (!empty()) {
+            long n = send_batch(fd);
+            if (n < 0) return false;
+            if (n == 0) break;
+            consume(static_cast<size_t>(n));
+        }
+        if (empty()) {
+            // Keep the capacity: the next response reuses it.
+            arena_.clear();
+            segs_.clear();
+            head_ = head_off_ = 0;
+            queued_ = sent_ = 0;
+        } else if (head_ >= COMPACT_SEGMENTS) {
+            compact();
+        }
+        return true;
+    }
+
+private:
+    struct Segment {
+        std::shared_ptr<const std::string> body;   // Null: bytes live in arena_
+        size_t off;
+        size_t len;
+    };
+
+    static constexpr size_t MAX_BATCH        = 64;   // Segments per send call
+    static constexpr size_t COMPACT_SEGMENTS = 256;
+
+    const char* data_of(const Segment& s) const {
+        return (s.body ? s.body->data() : arena_.data()) + s.off;
+    }
+
+    long send_batch(socket_t fd) {
+#ifdef _WIN32
+        WSABUF bufs[MAX_BATCH];
+        DWORD  count = 0;
+        for (size_t i = head_; i < segs_.size() && count < MAX_BATCH; ++i, ++count) {
+            size_t skip = (i == head_) ? head_off_ : 0;
+            bufs[count].buf = const_cast<char*>(data_of(segs_[i]) + skip);
+            bufs[count].len = static_cast<ULONG>(segs_[i].len - skip);
+        }
+        DWORD sent = 0;
+        if (::WSASend(fd, bufs, count, &sent, 0, nullptr, nullptr) == 0) return static_cast<long>(sent);
+        return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+#else
+        iovec  iov[MAX_BATCH];
+        size_t count = 0;
+        for (size_t i = head_; i < segs_.size() && count < MAX_BATCH; ++i, ++count) {
+            size_t skip = (i == head_) ? head_off_ : 0;
+            iov[count].iov_base = const_cast<char*>(data_of(segs_[i]) + skip);
+            iov[count].iov_len  = segs_[i].len - skip;
+        }
+        msghdr msg{};
+        msg.msg_iov    = iov;
+        msg.msg_iovlen = count;
+        for (;;) {
+            ssize_t n = ::sendmsg(fd, &msg, SEND_FLAGS);
+            if (n >= 0) return static_cast<long>(n);
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+#endif
+    }
+
+    void consume(size_t n) {
+        sent_ += n;
+        while (n > 0) {
+            Segment& s = segs_[head_];
+            size_t left = s.len - head_off_;
+            if (n < left) { head_off_ += n; return; }
+            n -= left;
+            s.body.reset();   // Release the shared body as soon as it is out
+            ++head_;
+            head_off_ = 0;
+        }
+    }
+
+    /// Drops sent segments and the arena bytes only they referenced, for a
+    /// queue that is kept busy and so never drains completely.
+    void compact() {
+        size_t arena_start = arena_.size();
+        for (size_t i = head_; i < segs_.size(); ++i) {
+            if (!segs_[i].body) { arena_start = segs_[i].off; break; }
+        }
+        arena_.erase(0, arena_start);
+        segs_.erase(segs_.begin(), segs_.begin() + static_cast<std::ptrdiff_t>(head_));
+        for (auto& seg : segs_) {
+            if (!seg.body) seg.off -= arena_start;
+        }
+        head_ = 0;
+    }
+
+    std::string          arena_;
+    std::vector<Segment> segs_;
+    size_t head_     = 0;   // First segment not fully sent
+    size_t head_off_ = 0;   // Bytes of segs_[head_] already sent
+    size_t queued_   = 0;
+    size_t sent_     = 0;
+};
+
+/// Large bodies are referenced rather than copied into the arena.
+static constexpr size_t COPY_BODY_MAX = 16 * 1024;
+
+/// Queues the response; takes ownership of a large resp.body.
+static void append_response(OutputQueue& out, third_eye::HttpResponse& resp, bool keep_alive) {
+    auto append_body = [&] {
+        if (resp.shared_body) {
+            out.append(resp.shared_body);
+        } else if (resp.body.size() <= COPY_BODY_MAX) {
+            out.append(resp.body);
+        } else {
+            out.append(std::make_shared<const std::string>(std::move(resp.body)));
+            resp.body.clear();
+        }
+    };
+
+    if (resp.stream) {
+        out.append("HTTP/1.1 200 OK\r\n"
+                   "Content-Type: text/event-stream\r\n"
+                   "Cache-Control: no-cache\r\n"
+                   "Access-Control-Allow-Origin: *\r\n"
+                   "Connection: keep-alive\r\n\r\n");
+        append_body();
+        return;
+    }
+
+    // Consecutive arena appends coalesce, so the headers go out as one segment.
+    auto append_num = [&out](auto v) {
+        char num[24];
+        out.append(std::string_view(num, static_cast<size_t>(std::to_chars(num, num + sizeof(num), v).ptr - num)));
+    };
+    out.append("HTTP/1.1 ");
+    append_num(resp.code);
+    out.append(" ");
+    out.append(status_text(resp.code));
+    out.append("\r\nContent-Type: ");
+    out.append(resp.content_type);
+    if (const char* enc = third_eye::content_encoding_name(resp.encoding)) {
+        out.append("\r\nContent-Encoding: ");
+        out.append(enc);
+    }
+    out.append("\r\nContent-Length: ");
+    append_num(resp.payload().size());
+    out.append("\r\n"
+               "Vary: Accept-Encoding\r\n"
+               "Access-Control-Allow-Origin: *\r\n"
+               "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+               "Access-Control-Allow-Headers: Content-Type\r\n");
+    out.append(keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+    append_body();
+}
+
+static void set_nonblocking(socket_t s) {
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(s, FIONBIO, &mode);
+#else
+    ::fcntl(s, F_SETFL, ::fcntl(s, F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+static std::string alert_json(const third_eye::AlertEntry& a) {
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    out << R"({"type":")" << json_escape(a.type) << "\""
+        << R"(,"severity":")" << json_escape(a.severity) << "\""
+        << R"(,"message":")" << json_escape(a.message) << "\""
+        << R"(,"timestamp":")" << json_escape(a.timestamp) << "\""
+        << R"(,"value":)" << json_double(a.value)
+        << R"(,"threshold":)" << json_double(a.threshold)
+        << R"(,"active":)" << (a.active ? "true" : "false")
+        << "}";
+    return out.str();
+}
+
+static std::string processes_json(const std::vector<third_eye::ProcessInfo>& procs) {
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    out << "[";
+    for (size_t i = 0; i < procs.size(); ++i) {
+        if (i > 0) out << ",";
+        out << R"({"pid":)" << procs[i].pid
+            << R"(,"name":")" << json_escape(procs[i].name) << "\""
+            << R"(,"cpu_percent":)" << json_double(procs[i].cpu_percent)
+            << R"(,"memory_bytes":)" << procs[i].memory_bytes
+            << R"(,"threads":)" << procs[i].threads
+            << R"(,"handles":)" << procs[i].handles
+            << R"(,"io_read_bytes":)" << procs[i].io_read_bytes
+            << R"(,"io_write_bytes":)" << procs[i].io_write_bytes
+            << R"(,"major_faults":)" << procs[i].major_faults
+            << "}";
+    }
+    out << "]";
+    return out.str();
+}
+
+static std::string groups_json(const std::vector<third_eye::ProcessGroupInfo>& groups) {
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    out << "[";
+    for (size_t i = 0; i < groups.size(); ++i) {
+        if (i > 0) out << ",";
+        out << R"({"name":")" << json_escape(groups[i].name) << "\""
+            << R"(,"leader_pid":)" << groups[i].leader_pid
+            << R"(,"processes":)" << groups[i].processes
+            << R"(,"cpu_percent":)" << json_double(groups[i].cpu_percent)
+            << R"(,"memory_bytes":)" << groups[i].memory_bytes
+            << "}";
+    }
+    out << "]";
+    return out.str();
+}
+
+/// {"<label value>":value,...} over the labeled series of `metric`, keyed
+/// by the value of their one label, or with `whole_labels` by the full
+/// label set. Shared by /api/status and the stream's "metrics" deltas.
+static constexpr std::string_view DURATIONS_METRIC = "the_third_eye_collector_duration_seconds";
+static constexpr std::string_view ERRORS_METRIC    = "the_third_eye_collect_errors_total";
+static constexpr std::string_view REQUESTS_METRIC  = "the_third_eye_http_requests_total";
+
+static std::string labeled_map_json(const std::vector<third_eye::MetricSnapshot>& snap,
+                                    std::string_view metric, bool whole_labels) {
+    std::string out = "{";
+    for (const auto& m : snap) {
+        if (m.name != metric || m.labels.empty()) continue;
+        std::string_view key = m.labels;
+        if (!whole_labels) {
+            auto start = key.find("=\"");
+            auto end   = key.find("\"}", start);
+            if (start == std::string_view::npos || end == std::string_view::npos) continue;
+            key = key.substr(start + 2, end - start - 2);
+        }
+        if (out.size() > 1) out += ',';
+        out += '"';
+        out += json_escape(key);
+        out += "\":";
+        out += json_double(m.value);
+    }
+    out += '}';
+    return out;
+}
+
+/// The "last_error" object, or empty while there has been none.
+static std::string last_error_json(const third_eye::LastError& le) {
+    if (le.collector.empty()) return {};
+    return R"({"collector":")" + json_escape(le.collector) + R"(","timestamp":")" + json_escape(le.timestamp) +
+           R"(","message":")" + json_escape(le.message) + "\"}";
+}
+
 namespace third_eye {
 
 HttpServer::HttpServer(uint16_t port, MetricsProvider provider,
                        Registry* registry, Agent* agent)
-    : port_(port), provider_(std::move(provider)), registry_(registry), agent_(agent) {}
+    : port_(port), provider_(std::move(provider)), registry_(registry), agent_(agent) {
+    if (registry_) {
+        metrics_requests_ = registry_->counter_handle("the_third_eye_http_requests_total",
+                                                      R"({code="200",path="/metrics"})");
+        status_requests_  = registry_->counter_handle("the_third_eye_http_requests_total",
+                                                      R"({code="200",path="/api/status"})");
+        snapshot_requests_ = registry_->counter_handle("the_third_eye_http_requests_total",
+                                                       R"({code="200",path="/api/snapshot.bin"})");
+        const char* help = "Compressed /metrics bodies reused from the cache (hit) or compressed anew (miss).";
+        compress_hits_   = registry_->register_counter("the_third_eye_http_compression_cache_total",
+                                                       help, R"({result="hit"})");
+        compress_misses_ = registry_->register_counter("the_third_eye_http_compression_cache_total",
+                                                       help, R"({result="miss"})");
+    }
+}
 
 HttpServer::~HttpServer() { stop(); }
 
@@ -115,24 +520,190 @@ void HttpServer::start() {
         throw std::runtime_error("Failed to bind on port " + std::to_string(port_));
     }
 
-    if (::listen(static_cast<socket_t>(listen_socket_), 8) < 0) {
+    if (::listen(static_cast<socket_t>(listen_socket_), 64) < 0) {
         close_socket(static_cast<socket_t>(listen_socket_));
         throw std::runtime_error("Failed to listen on port " + std::to_string(port_));
     }
 
     running_.store(true);
-    thread_ = std::jthread([this](std::stop_token) { accept_loop(); });
+
+#ifdef __linux__
+    auto lsock = static_cast<int>(listen_socket_);
+    set_nonblocking(lsock);
+
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_  = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        close_socket(lsock);
+        throw std::runtime_error("Failed to create epoll instance");
+    }
+
+    // The listen socket is one-shot too: whichever worker wins it drains
+    // the accept queue and re-arms it.
+    epoll_event ev{};
+    ev.events   = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = &listen_socket_;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, lsock, &ev);
+
+    // Level-triggered and never drained: once signalled, every worker wakes.
+    ev.events   = EPOLLIN;
+    ev.data.ptr = &wake_fd_;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    unsigned workers = std::clamp(std::thread::hardware_concurrency(), 2u, 4u);
+    for (unsigned i = 0; i < workers; ++i)
+        threads_.emplace_back([this](std::stop_token) { event_loop(); });
+#else
+    threads_.emplace_back([this](std::stop_token) { accept_loop(); });
+#endif
 }
 
 void HttpServer::stop() {
     if (!running_.exchange(false)) return;
+
+#ifdef __linux__
+    uint64_t one = 1;
+    [[maybe_unused]] auto w = ::write(wake_fd_, &one, sizeof(one));
+#endif
+    for (auto& t : threads_) {
+        if (t.joinable()) { t.request_stop(); t.join(); }
+    }
+    threads_.clear();
+
     if (static_cast<socket_t>(listen_socket_) != INVALID_SOCK) {
         close_socket(static_cast<socket_t>(listen_socket_));
         listen_socket_ = static_cast<uintptr_t>(INVALID_SOCK);
     }
-    if (thread_.joinable()) { thread_.request_stop(); thread_.join(); }
+
+    {
+        std::lock_guard lock(stream_mutex_);
+        streams_.clear();
+        stream_count_.store(0);
+    }
+
+#ifdef __linux__
+    {
+        std::lock_guard lock(conn_mutex_);
+        connections_.clear();
+    }
+    if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    if (wake_fd_  >= 0) ::close(wake_fd_);
+    epoll_fd_ = wake_fd_ = -1;
+#endif
+}
+
+HttpResponse HttpServer::route(const HttpRequest& req) {
+    HttpResponse resp;
+    resp.content_type = "application/json";
+
+    if (req.method == "OPTIONS") {
+        resp.content_type = "text/plain";
+        return resp;
+    }
+
+
+    if (req.method == "GET" && req.path == "/metrics") {
+        resp.content_type = "text/plain; version=0.0.4; charset=utf-8";
+        auto exposition   = provider_();
+        resp.shared_body  = std::move(exposition.body);
+        resp.body_version = exposition.version;
+        metrics_requests_.inc();
+        return resp;
+    }
+
+
+    if (req.method == "GET" && req.path == "/api/status") {
+        resp.body = handle_api_status();
+        status_requests_.inc();
+        return resp;
+    }
+
+
+    if (req.method == "GET" && req.path == "/api/stream") {
+        resp.stream       = true;
+        resp.content_type = "text/event-stream";
+        resp.body         = "retry: 2000\n\nevent: status\ndata: " + handle_api_status() + "\n\n";
+        return resp;
+    }
+
+
+    if (req.method == "GET" && req.path == "/api/logs") {
+        resp.body = handle_api_logs(req.query);
+        return resp;
+    }
+
+    if (req.method == "GET" && req.path == "/api/alerts") {
+        resp.body = handle_api_alerts();
+        return resp;
+    }
+
+    if (req.method == "GET" && req.path == "/api/query_range") {
+        return handle_api_query_range(req.query);
+    }
+
+    if (req.method == "GET" && req.path == "/api/snapshot.bin") {
+        return handle_api_snapshot_bin(req.query);
+    }
+
+    if (req.method == "POST" && req.path == "/api/config") {
+        resp.body = handle_api_config_post(std::string(req.body));
+        return resp;
+    }
+
+
+    resp.code         = 404;
+    resp.content_type = "text/plain";
+    resp.body         = "404 Not Found\n";
+    return resp;
 }
 
+/// Encodes the payload as the client asked, unless it is an event stream or
+/// too small to be worth it. The /metrics exposition keeps its compressed
+/// form until its version changes, so scrapers that arrive between two
+/// collection passes share one compression.
+void HttpServer::compress(const HttpRequest& req, HttpResponse& resp) {
+    ContentEncoding enc = req.accept_encoding;
+    if (enc == ContentEncoding::Identity || resp.stream) return;
+    if (resp.payload().size() < MIN_COMPRESS_BYTES) return;
+
+    auto& cached = compressed_[static_cast<size_t>(enc)];
+    if (resp.body_version) {
+        std::lock_guard lock(compress_mutex_);
+        if (cached.version == resp.body_version) {
+            resp.shared_body = cached.body;
+            resp.encoding    = enc;
+            compress_hits_.inc();
+            return;
+        }
+    }
+
+    auto out = std::make_shared<std::string>();
+    if (!compress_body(enc, resp.payload(), *out)) return;
+
+    if (resp.body_version) {
+        std::lock_guard lock(compress_mutex_);
+        cached.version = resp.body_version;
+        cached.body   = out;
+        compress_misses_.inc();
+    }
+    resp.shared_body = std::move(out);
+    resp.body.clear();
+    resp.encoding = enc;
+}
+
+/// Per-connection state of the epoll server (unused on Windows).
+struct HttpServer::Connection {
+    explicit Connection(socket_t s) : fd(s) {}
+    ~Connection() { close_socket(fd); }
+
+    socket_t    fd;
+    std::string in;                  // Received, not yet parsed
+    OutputQueue out;                 // Rendered, not yet sent
+    bool        close_after = false; // Close once `out` is flushed
+};
+
+// --- Windows: blocking sockets, one request per connection -----------------
+
 void HttpServer::accept_loop() {
     while (running_.load()) {
         auto sock = static_cast<socket_t>(listen_socket_);
@@ -162,106 +733,356 @@ void HttpServer::accept_loop() {
     }
 }
 
-void HttpServer::send_response(uintptr_t sock_ptr, int code, const std::string& content_type,
-                                const std::string& body) {
+void HttpServer::send_response(uintptr_t sock_ptr, HttpResponse& resp) {
     auto sock = static_cast<socket_t>(sock_ptr);
-    std::string status_text = (code == 200) ? "OK" : (code == 404 ? "Not Found" : "Bad Request");
-
-    std::ostringstream resp;
-    resp << "HTTP/1.1 " << code << " " << status_text << "\r\n"
-         << "Content-Type: " << content_type << "\r\n"
-         << "Content-Length: " << body.size() << "\r\n"
-         << "Access-Control-Allow-Origin: *\r\n"
-         << "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
-         << "Access-Control-Allow-Headers: Content-Type\r\n"
-         << "Connection: close\r\n"
-         << "\r\n"
-         << body;
-    std::string out = resp.str();
-    ::send(sock, out.c_str(), static_cast<int>(out.size()), 0);
+
+    // Blocking socket: each flush either sends something or fails.
+    OutputQueue out;
+    append_response(out, resp, false);
+    while (!out.empty() && out.flush(sock)) {}
     close_socket(sock);
 }
 
 void HttpServer::handle_client(uintptr_t client_socket) {
     auto sock = static_cast<socket_t>(client_socket);
 
-    char buf[4096]{};
-    int n = ::recv(sock, buf, sizeof(buf) - 1, 0);
-    if (n <= 0) { close_socket(sock); return; }
-    buf[n] = '\0';
+    // Receive straight into the request buffer, which is reused across clients.
+    std::string& buf = recv_buf_;
+    buf.clear();
+    HttpRequest req;
+    long used = 0;
+    while (used == 0) {
+        size_t have = buf.size();
+        buf.resize(have + RECV_CHUNK);
+        int n = ::recv(sock, buf.data() + have, static_cast<int>(RECV_CHUNK), 0);
+        if (n <= 0) { close_socket(sock); return; }
+        buf.resize(have + static_cast<size_t>(n));
+        used = parse_request(buf, req);
+    }
+    if (used < 0) {
+        HttpResponse bad;
+        bad.code = 400;
+        bad.content_type = "text/plain";
+        send_response(client_socket, bad);
+        return;
+    }
 
-    std::string request(buf, n);
+    HttpResponse resp = route(req);
+    compress(req, resp);
+    if (!resp.stream) {
+        send_response(client_socket, resp);
+        return;
+    }
+
+    // Event streams outlive this call: hand the socket to the broadcaster.
+    auto conn = std::make_unique<Connection>(sock);
+    append_response(conn->out, resp, true);
+    set_nonblocking(sock);
+    attach_stream(std::move(conn));
+}
 
+// --- Server-Sent Events ---------------------------------------------------
 
-    std::string method, path, query;
-    {
-        auto sp1 = request.find(' ');
-        if (sp1 == std::string::npos) { close_socket(sock); return; }
-        method = request.substr(0, sp1);
-        auto sp2 = request.find(' ', sp1 + 1);
-        std::string uri = request.substr(sp1 + 1, sp2 - sp1 - 1);
-        auto qm = uri.find('?');
-        if (qm != std::string::npos) {
-            path  = uri.substr(0, qm);
-            query = uri.substr(qm + 1);
+/// A stream client that falls this far behind is dropped rather than
+/// buffered without bound.
+static constexpr size_t STREAM_MAX_BACKLOG = 1024 * 1024;
+
+/// Pushes out whatever the socket accepts; false if the client is gone or
+/// too far behind.
+static bool flush_stream(socket_t fd, OutputQueue& out) {
+    return out.flush(fd) && out.pending() <= STREAM_MAX_BACKLOG;
+}
+
+void HttpServer::attach_stream(std::unique_ptr<Connection> conn) {
+    std::lock_guard lock(stream_mutex_);
+    if (streams_.size() >= MAX_STREAMS) return;
+    if (!flush_stream(conn->fd, conn->out)) return;
+    streams_.push_back(std::move(conn));
+    stream_count_.store(streams_.size());
+}
+
+void HttpServer::broadcast(std::string_view event, std::string_view data) {
+    // One frame shared by every client's queue.
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(event.size() + data.size() + 16);
+    *frame += "event: ";
+    *frame += event;
+    *frame += "\ndata: ";
+    *frame += data;
+    *frame += "\n\n";
+    std::shared_ptr<const std::string> shared = std::move(frame);
+
+    std::lock_guard lock(stream_mutex_);
+    for (size_t i = 0; i < streams_.size();) {
+        auto& c = *streams_[i];
+        c.out.append(shared);
+        if (flush_stream(c.fd, c.out)) {
+            ++i;
         } else {
-            path = uri;
+            streams_[i] = std::move(streams_.back());
+            streams_.pop_back();
         }
     }
+    stream_count_.store(streams_.size());
+}
 
+void HttpServer::publish_metrics() {
+    if (stream_count_.load(std::memory_order_relaxed) == 0 || !registry_) return;
+
+    // Gather first: this takes the registry and agent locks.
+    std::vector<std::pair<std::string_view, double>> current;
+    std::vector<MetricSnapshot> labeled;
+    registry_->visit([&](const std::string& name, const MetricSeries& s) {
+        if (!s.labels.empty()) {
+            if (name == DURATIONS_METRIC || name == ERRORS_METRIC || name == REQUESTS_METRIC)
+                labeled.push_back({name, s.labels, s.current()});
+            return;
+        }
+        std::string_view key = name;
+        if (key.starts_with("the_third_eye_")) key.remove_prefix(14);
+        if (key == "agent_uptime_seconds") return;
+        current.emplace_back(key, s.current());
+    });
+
+    // Objects and arrays are sent whole whenever their JSON differs from
+    // what was last pushed; the client merges fields shallowly.
+    std::pair<std::string_view, std::string> sections[] = {
+        {"collector_durations", labeled_map_json(labeled, DURATIONS_METRIC, false)},
+        {"collect_errors",      labeled_map_json(labeled, ERRORS_METRIC, false)},
+        {"http_requests",       labeled_map_json(labeled, REQUESTS_METRIC, true)},
+        {"last_error",          agent_ ? last_error_json(agent_->last_error()) : std::string()},
+        {"top_processes",       agent_ ? processes_json(agent_->get_processes()) : "[]"},
+        {"top_groups",          agent_ ? groups_json(agent_->get_groups()) : "[]"},
+    };
 
-    if (method == "OPTIONS") {
-        send_response(client_socket, 200, "text/plain", "");
-        return;
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    out << "{";
+    if (agent_) {
+        double uptime = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - agent_->start_time()).count();
+        out << R"("agent_uptime_seconds":)" << json_double(uptime)
+            << R"(,"health":")" << agent_->compute_health() << "\""
+            << R"(,"active_alerts_count":)" << agent_->active_alerts().size();
+    }
+    {
+        std::lock_guard lock(stream_mutex_);
+        for (const auto& [key, value] : current) {
+            auto [it, inserted] = pushed_values_.try_emplace(std::string(key), value);
+            if (!inserted && it->second == value) continue;
+            it->second = value;
+            out << ",\"" << key << "\":" << json_double(value);
+        }
+        for (auto& [key, json] : sections) {
+            if (json.empty()) continue;
+            auto [it, inserted] = pushed_sections_.try_emplace(std::string(key));
+            if (!inserted && it->second == json) continue;
+            out << ",\"" << key << "\":" << json;
+            it->second = std::move(json);
+        }
     }
+    out << "}";
+
+    broadcast("metrics", out.str());
+}
+
+/// One /api/logs entry or "log" event.
+static void append_log_json(std::string& out, uint64_t seq, third_eye::LogLevel level,
+                            int64_t timestamp_ms, std::string_view message) {
+    char ts[32];
+    out += R"({"seq":)";
+    out += std::to_string(seq);
+    out += R"(,"timestamp":")";
+    out += third_eye::format_log_time(timestamp_ms, ts);
+    out += R"(","timestamp_ms":)";
+    out += std::to_string(timestamp_ms);
+    out += R"(,"level":")";
+    out += third_eye::log_level_name(level);
+    out += R"(","message":")";
+    out += json_escape(message);
+    out += "\"}";
+}
 
+void HttpServer::publish_log(uint64_t seq, LogLevel level, int64_t timestamp_ms, std::string_view message) {
+    if (stream_count_.load(std::memory_order_relaxed) == 0) return;
 
-    if (method == "GET" && path == "/metrics") {
-        std::string body = provider_();
-        send_response(client_socket, 200, "text/plain; version=0.0.4; charset=utf-8", body);
-        if (registry_) {
-            registry_->counter_inc("the_third_eye_http_requests_total",
-                                   R"({code="200",path="/metrics"})", 1.0);
+    std::string data;
+    append_log_json(data, seq, level, timestamp_ms, message);
+    broadcast("log", data);
+}
+
+void HttpServer::publish_alert(const AlertEntry& alert, bool fired) {
+    if (stream_count_.load(std::memory_order_relaxed) == 0) return;
+
+    std::string data = alert_json(alert);
+    data.insert(1, fired ? R"("transition":"fired",)" : R"("transition":"resolved",)");
+    broadcast("alert", data);
+}
+
+// --- Linux: epoll, non-blocking sockets, keep-alive and pipelining --------
+
+#ifdef __linux__
+
+/// Stop parsing pipelined requests once this much output is queued, so a
+/// client that never reads cannot make the agent buffer without bound.
+static constexpr size_t OUTPUT_HIGH_WATER = 4 * 1024 * 1024;
+
+void HttpServer::event_loop() {
+    while (running_.load()) {
+        epoll_event ev{};
+        int n = ::epoll_wait(epoll_fd_, &ev, 1, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
         }
-        return;
+        if (n == 0) continue;
+
+        if (ev.data.ptr == &wake_fd_) break;
+        if (ev.data.ptr == &listen_socket_) {
+            accept_pending();
+            continue;
+        }
+        service(static_cast<Connection*>(ev.data.ptr), ev.events);
     }
+}
 
+void HttpServer::accept_pending() {
+    auto lsock = static_cast<int>(listen_socket_);
 
-    if (method == "GET" && path == "/api/status") {
-        send_response(client_socket, 200, "application/json", handle_api_status());
-        if (registry_) {
-            registry_->counter_inc("the_third_eye_http_requests_total",
-                                   R"({code="200",path="/api/status"})", 1.0);
+    for (;;) {
+        int fd = ::accept4(lsock, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;  // EAGAIN: queue drained
         }
-        return;
-    }
 
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
 
-    if (method == "GET" && path == "/api/logs") {
-        send_response(client_socket, 200, "application/json", handle_api_logs(query));
-        return;
+        auto conn = std::make_unique<Connection>(fd);
+        Connection* raw = conn.get();
+        {
+            std::lock_guard lock(conn_mutex_);
+            if (connections_.size() >= MAX_CONNECTIONS) continue;  // conn dtor closes fd
+            connections_.emplace(fd, std::move(conn));
+        }
+
+        epoll_event ev{};
+        ev.events   = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.ptr = raw;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) close_connection(raw);
     }
 
-    if (method == "GET" && path == "/api/alerts") {
-        send_response(client_socket, 200, "application/json", handle_api_alerts());
-        return;
+    epoll_event ev{};
+    ev.events   = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = &listen_socket_;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, lsock, &ev);
+}
+
+void HttpServer::close_connection(Connection* conn) {
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn->fd, nullptr);
+    std::lock_guard lock(conn_mutex_);
+    connections_.erase(conn->fd);
+}
+
+void HttpServer::service(Connection* c, uint32_t events) {
+    bool peer_closed = (events & (EPOLLHUP | EPOLLERR)) != 0;
+
+    if (events & EPOLLIN) {
+        for (;;) {
+            // Receive straight into the connection's buffer, whose capacity
+            // survives between requests.
+            size_t have = c->in.size();
+            c->in.resize(have + RECV_CHUNK);
+            ssize_t n = ::recv(c->fd, c->in.data() + have, RECV_CHUNK, 0);
+            c->in.resize(have + static_cast<size_t>(std::max<ssize_t>(n, 0)));
+            if (n > 0) {
+                if (c->in.size() > 4 * MAX_REQUEST_BYTES) break;
+                continue;
+            }
+            if (n == 0) { peer_closed = true; break; }
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) peer_closed = true;
+            break;
+        }
     }
+    if (events & EPOLLRDHUP) peer_closed = true;
+
+    for (;;) {
+        // Answer every complete request already buffered, in order.
+        size_t consumed  = 0;
+        bool   streaming = false;
+        while (!c->close_after && c->out.pending() < OUTPUT_HIGH_WATER) {
+            HttpRequest req;
+            long used = parse_request(std::string_view(c->in).substr(consumed), req);
+            if (used == 0) break;
+            if (used < 0) {
+                HttpResponse bad;
+                bad.code = 400;
+                bad.content_type = "text/plain";
+                append_response(c->out, bad, false);
+                c->close_after = true;
+                break;
+            }
+            consumed += static_cast<size_t>(used);
+            HttpResponse resp = route(req);
+            compress(req, resp);
+            append_response(c->out, resp, req.keep_alive);
+            if (resp.stream) { streaming = true; break; }
+            if (!req.keep_alive) c->close_after = true;
+        }
+        c->in.erase(0, consumed);
+
+        if (streaming) {
+            // Leave the epoll set for good; from now on only broadcast() writes.
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c->fd, nullptr);
+            std::unique_ptr<Connection> owned;
+            {
+                std::lock_guard lock(conn_mutex_);
+                auto it = connections_.find(c->fd);
+                owned = std::move(it->second);
+                connections_.erase(it);
+            }
+            owned->in.clear();
+            attach_stream(std::move(owned));
+            return;
+        }
 
-    if (method == "POST" && path == "/api/config") {
+        if (!c->out.flush(c->fd)) { close_connection(c); return; }
 
-        std::string post_body;
-        auto hdr_end = request.find("\r\n\r\n");
-        if (hdr_end != std::string::npos) {
-            post_body = request.substr(hdr_end + 4);
+        if (!c->out.empty()) {
+            // Socket buffer full: wait for it to drain before reading more.
+            epoll_event ev{};
+            ev.events   = EPOLLOUT | EPOLLONESHOT;
+            ev.data.ptr = c;
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c->fd, &ev);
+            return;
         }
-        send_response(client_socket, 200, "application/json", handle_api_config_post(post_body));
-        return;
+
+        if (c->close_after) { close_connection(c); return; }
+
+        // Output flushed; keep going if the high-water mark held back requests.
+        HttpRequest probe;
+        if (parse_request(c->in, probe) == 0 || c->in.empty()) break;
     }
 
+    if (peer_closed) { close_connection(c); return; }
 
-    send_response(client_socket, 404, "text/plain", "404 Not Found\n");
+    epoll_event ev{};
+    ev.events   = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.ptr = c;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c->fd, &ev);
 }
 
+#else
+
+void HttpServer::event_loop() {}
+void HttpServer::accept_pending() {}
+void HttpServer::service(Connection*, uint32_t) {}
+void HttpServer::close_connection(Connection*) {}
+
+#endif
+
 
 
 std::string HttpServer::handle_api_status() {
@@ -278,11 +1099,20 @@ std::string HttpServer::handle_api_status() {
 
 
     if (agent_) {
-        auto& cfg = agent_->config();
+        auto cfg = agent_->config();
         out << R"(,"port":)" << cfg.port;
-        out << R"(,"interval":)" << cfg.interval;
+        out << R"(,"interval":)" << json_double(cfg.interval_ms / 1000.0);
+        out << R"(,"interval_ms":)" << cfg.interval_ms;
         out << R"(,"log_level":")" << (cfg.log_level == LogLevel::Debug ? "debug" : "info") << "\"";
 
+        out << R"(,"collector_intervals":{)";
+        auto intervals = agent_->collector_intervals();
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            if (i > 0) out << ",";
+            out << "\"" << json_escape(intervals[i].first) << "\":" << intervals[i].second;
+        }
+        out << "}";
+
         // Computed live rather than from registry snapshot
         auto agent_elapsed = std::chrono::steady_clock::now() - agent_->start_time();
         double agent_uptime = std::chrono::duration<double>(agent_elapsed).count();
@@ -290,13 +1120,8 @@ std::string HttpServer::handle_api_status() {
 
         out << R"(,"health":")" << agent_->compute_health() << "\"";
 
-        auto le = agent_->last_error();
-        if (!le.collector.empty()) {
-            out << R"(,"last_error":{"collector":")" << json_escape(le.collector)
-                << R"(","timestamp":")" << json_escape(le.timestamp)
-                << R"(","message":")" << json_escape(le.message)
-                << "\"}";
-        }
+        auto le = last_error_json(agent_->last_error());
+        if (!le.empty()) out << R"(,"last_error":)" << le;
     }
 
 
@@ -318,117 +1143,214 @@ std::string HttpServer::handle_api_status() {
         }
 
 
-        out << R"(,"collector_durations":{)";
-        bool first = true;
-        for (const auto& m : snap) {
-            if (m.name == "the_third_eye_collector_duration_seconds" && !m.labels.empty()) {
-
-                auto start = m.labels.find("=\"");
-                auto end = m.labels.find("\"}", start);
-                if (start != std::string::npos && end != std::string::npos) {
-                    std::string col = m.labels.substr(start + 2, end - start - 2);
-                    if (!first) out << ",";
-                    out << "\"" << col << "\":" << json_double(m.value);
-                    first = false;
-                }
-            }
-        }
-        out << "}";
-
-
-        out << R"(,"collect_errors":{)";
-        first = true;
-        for (const auto& m : snap) {
-            if (m.name == "the_third_eye_collect_errors_total" && !m.labels.empty()) {
-                auto start = m.labels.find("=\"");
-                auto end = m.labels.find("\"}", start);
-                if (start != std::string::npos && end != std::string::npos) {
-                    std::string col = m.labels.substr(start + 2, end - start - 2);
-                    if (!first) out << ",";
-                    out << "\"" << col << "\":" << json_double(m.value);
-                    first = false;
-                }
-            }
-        }
-        out << "}";
-
-
-        out << R"(,"http_requests":{)";
-        first = true;
-        for (const auto& m : snap) {
-            if (m.name == "the_third_eye_http_requests_total" && !m.labels.empty()) {
-                if (!first) out << ",";
-                out << "\"" << json_escape(m.labels) << "\":" << json_double(m.value);
-                first = false;
-            }
-        }
-        out << "}";
+        out << R"(,"collector_durations":)" << labeled_map_json(snap, DURATIONS_METRIC, false);
+        out << R"(,"collect_errors":)" << labeled_map_json(snap, ERRORS_METRIC, false);
+        out << R"(,"http_requests":)" << labeled_map_json(snap, REQUESTS_METRIC, true);
     }
 
     if (agent_) {
-        auto procs = agent_->get_processes();
-        out << R"(,"top_processes":[)";
-        for (size_t i = 0; i < procs.size(); ++i) {
-            if (i > 0) out << ",";
-            out << R"({"pid":)" << procs[i].pid
-                << R"(,"name":")" << json_escape(procs[i].name) << "\""
-                << R"(,"cpu_percent":)" << json_double(procs[i].cpu_percent)
-                << R"(,"memory_bytes":)" << procs[i].memory_bytes
-                << "}";
-        }
-        out << "]";
+        out << R"(,"top_processes":)" << processes_json(agent_->get_processes());
+        out << R"(,"top_groups":)" << groups_json(agent_->get_groups());
 
         auto active = agent_->active_alerts();
         out << R"(,"active_alerts_count":)" << active.size();
 
-        out << R"(,"cpu_threshold":)" << json_double(agent_->config().cpu_threshold);
-        out << R"(,"memory_threshold":)" << json_double(agent_->config().memory_threshold);
-        out << R"(,"collect_threshold":)" << json_double(agent_->config().collect_threshold);
+        auto cfg = agent_->config();
+        out << R"(,"cpu_threshold":)" << json_double(cfg.cpu_threshold);
+        out << R"(,"memory_threshold":)" << json_double(cfg.memory_threshold);
+        out << R"(,"collect_threshold":)" << json_double(cfg.collect_threshold);
+        out << R"(,"core_threshold":)" << json_double(cfg.core_threshold);
     }
 
     out << "}";
     return out.str();
 }
 
-std::string HttpServer::handle_api_logs(const std::string& query) {
-    if (!agent_) return R"({"logs":[]})";
+std::string HttpServer::handle_api_logs(std::string_view query) {
+    if (!agent_) return R"({"logs":[],"last_seq":0})";
 
+    // ?level=INFO|DEBUG|ERROR, ?limit=<n> (newest n), ?since=<seq> (only
+    // records after the last_seq of an earlier response).
+    std::optional<LogLevel> level;
+    bool     unknown_level = false;
+    size_t   limit = 500;
+    uint64_t since = 0;
+    while (!query.empty()) {
+        auto amp = query.find('&');
+        std::string_view param = query.substr(0, amp);
+        query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
 
-    std::string level;
-    int limit = 500;
-    std::istringstream qs(query);
-    std::string param;
-    while (std::getline(qs, param, '&')) {
         auto eq = param.find('=');
-        if (eq == std::string::npos) continue;
-        std::string key = param.substr(0, eq);
-        std::string val = param.substr(eq + 1);
-        if (key == "level") level = val;
-        else if (key == "limit") {
-            try { limit = std::stoi(val); } catch (...) {}
+        if (eq == std::string_view::npos) continue;
+        std::string_view key = param.substr(0, eq);
+        std::string_view val = param.substr(eq + 1);
+        if (key == "level") {
+            if (val.empty()) continue;
+            level = parse_log_level(val);
+            unknown_level = !level;
+        } else if (key == "limit") {
+            std::from_chars(val.data(), val.data() + val.size(), limit);
+        } else if (key == "since") {
+            std::from_chars(val.data(), val.data() + val.size(), since);
         }
     }
 
-    auto logs = agent_->get_logs(level, limit);
+    // Only the requested records are copied out of the ring, into a buffer
+    // each server thread keeps between polls.
+    thread_local std::vector<LogRecord> records;
+    uint64_t last_seq = agent_->get_logs(since, level, unknown_level ? 0 : limit, records);
 
-    std::ostringstream out;
-    out << R"({"logs":[)";
-    for (size_t i = 0; i < logs.size(); ++i) {
-        if (i > 0) out << ",";
-        out << R"({"timestamp":")" << json_escape(logs[i].timestamp)
-            << R"(","level":")" << json_escape(logs[i].level)
-            << R"(","message":")" << json_escape(logs[i].message)
-            << "\"}";
+    std::string out;
+    out.reserve(64 + records.size() * 160);
+    out += R"({"logs":[)";
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (i > 0) out += ',';
+        const auto& r = records[i];
+        append_log_json(out, r.seq, r.level, r.timestamp_ms, r.message());
     }
-    out << "]}";
-    return out.str();
+    out += R"(],"last_seq":)";
+    out += std::to_string(last_seq);
+    out += '}';
+    return out;
+}
+
+HttpResponse HttpServer::handle_api_snapshot_bin(std::string_view query) {
+    HttpResponse resp;
+    if (!registry_) {
+        resp.code         = 503;
+        resp.content_type = "text/plain";
+        resp.body         = "registry unavailable\n";
+        return resp;
+    }
+
+    // ?epoch=<n>: the layout epoch whose name table the client already has.
+    uint64_t known_epoch = 0;
+    while (!query.empty()) {
+        auto amp = query.find('&');
+        std::string_view param = query.substr(0, amp);
+        query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+        if (param.starts_with("epoch=")) {
+            param.remove_prefix(6);
+            std::from_chars(param.data(), param.data() + param.size(), known_epoch);
+        }
+    }
+
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    resp.content_type = "application/vnd.third-eye.snapshot";
+    registry_->encode_snapshot(resp.body, known_epoch, static_cast<uint64_t>(now_ms));
+    snapshot_requests_.inc();
+    return resp;
+}
+
+HttpResponse HttpServer::handle_api_query_range(std::string_view query) {
+    static constexpr size_t MAX_POINTS = 11000;
+
+    HttpResponse resp;
+    resp.content_type = "application/json";
+    auto fail = [&](const char* msg) {
+        resp.code = 400;
+        resp.body = std::string(R"({"error":")") + msg + "\"}";
+        return resp;
+    };
+    if (!agent_) return fail("agent unavailable");
+
+    int64_t end_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    int64_t start_ms = -1;
+    int64_t step_ms  = 0;
+    Aggregation agg  = Aggregation::Last;
+    std::string metric;
+
+    while (!query.empty()) {
+        auto amp = query.find('&');
+        std::string_view param = query.substr(0, amp);
+        query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+
+        auto eq = param.find('=');
+        if (eq == std::string_view::npos) continue;
+        std::string_view key = param.substr(0, eq);
+        std::string_view val = param.substr(eq + 1);
+
+        if (key == "metric") {
+            metric = val;
+        } else if (key == "start" || key == "end") {
+            double secs = 0.0;
+            auto [p, ec] = std::from_chars(val.data(), val.data() + val.size(), secs);
+            if (ec != std::errc{} || p != val.data() + val.size()) return fail("invalid start/end");
+            double ms = secs * 1000.0;
+            if (!std::isfinite(ms) || std::abs(ms) > static_cast<double>(INT64_MAX / 2))
+                return fail("invalid start/end");
+            (key == "start" ? start_ms : end_ms) = static_cast<int64_t>(ms);
+        } else if (key == "step") {
+            if (!parse_duration_ms(val, step_ms)) return fail("invalid step");
+        } else if (key == "agg") {
+            if (!parse_aggregation(val, agg)) return fail("agg must be last, avg, min or max");
+        }
+    }
+
+    if (metric.empty()) return fail("missing metric");
+    if (start_ms < 0) start_ms = end_ms - 3600 * 1000;
+    if (end_ms < start_ms) return fail("end before start");
+    if (step_ms > 0 && static_cast<uint64_t>((end_ms - start_ms) / step_ms) >= MAX_POINTS)
+        return fail("too many points; increase step");
+
+    // Memory answers from a rollup tier when the step allows one. The disk
+    // store keeps only raw samples, but reaches further back: it is used
+    // when there is no tier for the step, or the tier does not cover `start`.
+    const auto& memory = agent_->history();
+    int64_t resolution = TimeSeriesStore::resolution_for(step_ms);
+    const SegmentStore* disk = agent_->disk_history();
+    if (disk && resolution > 0 && memory.retained_since(step_ms) <= start_ms) disk = nullptr;
+    if (disk) resolution = 0;
+
+    auto series = disk ? disk->query(metric, start_ms, end_ms, step_ms, agg)
+                       : memory.query(metric, start_ms, end_ms, step_ms, agg);
+
+    std::string& out = resp.body;
+    out.reserve(256 + series.size() * 64);
+    out += R"({"metric":")";
+    out += json_escape(metric);
+    out += R"(","source":")";
+    out += disk ? "disk" : "memory";
+    out += R"(","resolution_ms":)";
+    out += std::to_string(resolution);
+    out += R"(,"series":[)";
+
+    char num[32];
+    for (size_t i = 0; i < series.size(); ++i) {
+        const auto& pts = series[i].points;
+        if (i > 0) out += ',';
+        out += R"({"labels":")";
+        out += json_escape(series[i].labels);
+        out += R"(","points":[)";
+        // Raw queries keep the most recent MAX_POINTS samples.
+        size_t first = pts.size() > MAX_POINTS ? pts.size() - MAX_POINTS : 0;
+        for (size_t k = first; k < pts.size(); ++k) {
+            if (k > first) out += ',';
+            out += '[';
+            auto r = std::to_chars(num, num + sizeof(num), static_cast<double>(pts[k].ts_ms) / 1000.0);
+            out.append(num, r.ptr);
+            out += ',';
+            if (std::isfinite(pts[k].value)) {
+                r = std::to_chars(num, num + sizeof(num), pts[k].value);
+                out.append(num, r.ptr);
+            } else {
+                out += "null";
+            }
+            out += ']';
+        }
+        out += "]}";
+    }
+    out += "]}";
+    return resp;
 }
 
 std::string HttpServer::handle_api_config_post(const std::string& body) {
     if (!agent_) return R"({"ok":false,"error":"agent unavailable"})";
 
 
-    int interval = -1;
+    int64_t interval_ms = -1;
     std::string log_level;
 
     auto find_int = [&](const std::string& key) -> int {
@@ -449,10 +1371,47 @@ std::string HttpServer::handle_api_config_post(const std::string& body) {
         return body.substr(pos + 1, end - pos - 1);
     };
 
-    interval  = find_int("interval");
+    // "interval_ms": 500, or "interval" as seconds (2, 0.5) or a string ("500ms").
+    interval_ms = find_int("interval_ms");
+    if (interval_ms <= 0) {
+        auto pos = body.find("\"interval\"");
+        if (pos != std::string::npos && (pos = body.find(':', pos)) != std::string::npos) {
+            auto begin = body.find_first_not_of(" \t\r\n\"", pos + 1);
+            auto end   = begin == std::string::npos ? begin : body.find_first_of(",}\"", begin);
+            if (end != std::string::npos &&
+                !parse_duration_ms(std::string_view(body).substr(begin, end - begin), interval_ms)) {
+                interval_ms = -1;
+            }
+        }
+    }
     log_level = find_str("log_level");
 
-    agent_->update_config(interval, log_level);
+    agent_->update_config(interval_ms, log_level);
+
+    // "collector_intervals":{"cpu":500,...} in milliseconds
+    auto ci = body.find("\"collector_intervals\"");
+    if (ci != std::string::npos) {
+        auto open  = body.find('{', ci);
+        auto close = open == std::string::npos ? open : body.find('}', open);
+        if (close != std::string::npos) {
+            std::string_view obj(body.data() + open + 1, close - open - 1);
+            while (true) {
+                auto q1 = obj.find('"');
+                if (q1 == std::string_view::npos) break;
+                auto q2 = obj.find('"', q1 + 1);
+                auto colon = q2 == std::string_view::npos ? q2 : obj.find(':', q2);
+                if (colon == std::string_view::npos) break;
+                std::string name(obj.substr(q1 + 1, q2 - q1 - 1));
+                auto num = obj.find_first_not_of(" \t\r\n", colon + 1);
+                uint32_t ms = 0;
+                if (num != std::string_view::npos) {
+                    auto [p, ec] = std::from_chars(obj.data() + num, obj.data() + obj.size(), ms);
+                    if (ec == std::errc{} && ms > 0) agent_->set_collector_interval(name, ms);
+                }
+                obj.remove_prefix(colon + 1);
+            }
+        }
+    }
 
     auto find_double = [&](const std::string& key) -> double {
         auto pos = body.find("\"" + key + "\"");
@@ -465,12 +1424,14 @@ std::string HttpServer::handle_api_config_post(const std::string& body) {
     double cpu_t  = find_double("cpu_threshold");
     double mem_t  = find_double("memory_threshold");
     double col_t  = find_double("collect_threshold");
+    double core_t = find_double("core_threshold");
 
-    auto& cfg = agent_->config();
+    auto cfg = agent_->config();
     if (cpu_t < 0) cpu_t = cfg.cpu_threshold;
     if (mem_t < 0) mem_t = cfg.memory_threshold;
     if (col_t < 0) col_t = cfg.collect_threshold;
-    agent_->update_thresholds(cpu_t, mem_t, col_t);
+    if (core_t < 0) core_t = cfg.core_threshold;
+    agent_->update_thresholds(cpu_t, mem_t, col_t, core_t);
 
     return R"({"ok":true})";
 }
@@ -486,14 +1447,7 @@ std::string HttpServer::handle_api_alerts() {
 
     auto write_alert = [&](const auto& a, bool first) {
         if (!first) out << ",";
-        out << R"({"type":")" << json_escape(a.type) << "\""
-            << R"(,"severity":")" << json_escape(a.severity) << "\""
-            << R"(,"message":")" << json_escape(a.message) << "\""
-            << R"(,"timestamp":")" << json_escape(a.timestamp) << "\""
-            << R"(,"value":)" << json_double(a.value)
-            << R"(,"threshold":)" << json_double(a.threshold)
-            << R"(,"active":)" << (a.active ? "true" : "false")
-            << "}";
+        out << alert_json(a);
     };
 
     out << R"({"active":[)";
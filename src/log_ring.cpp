@@ -0,0 +1,133 @@
+#include "third_eye/log_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+namespace third_eye {
+
+const char* log_level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Error: return "ERROR";
+        default:              return "INFO";
+    }
+}
+
+std::optional<LogLevel> parse_log_level(std::string_view name) {
+    if (name == "INFO")  return LogLevel::Info;
+    if (name == "DEBUG") return LogLevel::Debug;
+    if (name == "ERROR") return LogLevel::Error;
+    return std::nullopt;
+}
+
+std::string_view format_log_time(int64_t timestamp_ms, char (&buf)[32]) {
+    auto t = static_cast<std::time_t>(timestamp_ms / 1000);
+    std::tm tm_buf{};
+#ifdef _WIN32
+    localtime_s(&tm_buf, &t);
+#else
+    localtime_r(&t, &tm_buf);
+#endif
+    size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_buf);
+    return {buf, n};
+}
+
+
+// --- LogRing -----------------------------------------------------------------
+
+LogRing::LogRing(size_t capacity) : slots_(capacity ? capacity : 1) {}
+
+uint64_t LogRing::push(LogLevel level, int64_t timestamp_ms, std::string_view message) {
+    size_t len = std::min(message.size(), LogRecord::MAX_MESSAGE);
+    uint64_t seq;
+    {
+        std::lock_guard lock(mutex_);
+        seq = next_seq_++;
+        LogRecord& r = slots_[(seq - 1) % slots_.size()];
+        r.seq          = seq;
+        r.timestamp_ms = timestamp_ms;
+        r.level        = level;
+        r.length       = static_cast<uint16_t>(len);
+        std::memcpy(r.text, message.data(), len);
+    }
+    cv_.notify_all();
+    return seq;
+}
+
+uint64_t LogRing::read(uint64_t since, std::optional<LogLevel> level, size_t limit,
+                       std::vector<LogRecord>& out) const {
+    out.clear();
+    std::lock_guard lock(mutex_);
+    uint64_t last   = next_seq_ - 1;
+    uint64_t oldest = last >= slots_.size() ? last - slots_.size() + 1 : 1;
+
+    // Newest first, so `limit` keeps the most recent matches.
+    for (uint64_t seq = last; seq >= oldest && seq > since && out.size() < limit; --seq) {
+        const LogRecord& r = slots_[(seq - 1) % slots_.size()];
+        if (!level || r.level == *level) out.push_back(r);
+    }
+    std::reverse(out.begin(), out.end());
+    return last;
+}
+
+void LogRing::wait_after(uint64_t seq, std::stop_token stop) const {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, stop, [&] { return next_seq_ - 1 > seq; });
+}
+
+uint64_t LogRing::last_seq() const {
+    std::lock_guard lock(mutex_);
+    return next_seq_ - 1;
+}
+
+
+// --- ConsoleLogWriter --------------------------------------------------------
+
+ConsoleLogWriter::ConsoleLogWriter(const LogRing& ring)
+    : ring_(ring)
+    , thread_([this](std::stop_token stop) { run(stop); }) {}
+
+ConsoleLogWriter::~ConsoleLogWriter() {
+    thread_.request_stop();
+    if (thread_.joinable()) thread_.join();
+    drain();
+}
+
+void ConsoleLogWriter::run(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        ring_.wait_after(written_, stop);
+        drain();
+    }
+}
+
+void ConsoleLogWriter::drain() {
+    ring_.read(written_, std::nullopt, ring_.capacity(), batch_);
+    if (batch_.empty()) return;
+
+    std::string out, err;
+    if (batch_.front().seq > written_ + 1) {
+        out += "[log] " + std::to_string(batch_.front().seq - written_ - 1) +
+               " lines dropped: console writer fell behind\n";
+    }
+    char ts[32];
+    for (const auto& r : batch_) {
+        bool error = r.level == LogLevel::Error;
+        std::string& dst = error ? err : out;
+        dst += '[';
+        dst += format_log_time(r.timestamp_ms, ts);
+        dst += "] [";
+        dst += log_level_name(r.level);
+        dst += error ? "] " : "]  ";
+        dst += r.message();
+        dst += '\n';
+    }
+    written_ = batch_.back().seq;
+
+    if (!out.empty()) std::cout.write(out.data(), static_cast<std::streamsize>(out.size())).flush();
+    if (!err.empty()) std::cerr.write(err.data(), static_cast<std::streamsize>(err.size()));
+}
+
+}
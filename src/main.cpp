@@ -2,8 +2,13 @@
 
 #include "third_eye/agent.hpp"
 #include "third_eye/collector.hpp"
+#include "third_eye/duration.hpp"
 
+#include <charconv>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <cstdlib>
 #include <csignal>
@@ -18,11 +23,13 @@
 #endif
 
 
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
 extern std::unique_ptr<third_eye::Collector> create_cpu_collector();
 extern std::unique_ptr<third_eye::Collector> create_memory_collector();
 extern std::unique_ptr<third_eye::Collector> create_system_collector();
 extern std::unique_ptr<third_eye::Collector> create_process_collector(int top_n, third_eye::Agent* agent);
+extern std::unique_ptr<third_eye::Collector> create_network_collector();
+extern std::unique_ptr<third_eye::Collector> create_disk_collector();
 #endif
 
 
@@ -62,6 +69,27 @@ static std::string get_arg(int argc, char* argv[],
     return default_val;
 }
 
+/// Byte count with an optional K, M or G suffix (powers of 1024), with or
+/// without a trailing "B": 536870912, 512M, 512MB, 2G.
+static bool parse_size_bytes(std::string s, uint64_t& out) {
+    if (!s.empty() && (s.back() == 'B' || s.back() == 'b')) s.pop_back();
+    uint64_t scale = 1;
+    if (!s.empty()) {
+        switch (s.back()) {
+            case 'K': case 'k': scale = 1ULL << 10; break;
+            case 'M': case 'm': scale = 1ULL << 20; break;
+            case 'G': case 'g': scale = 1ULL << 30; break;
+            default: break;
+        }
+        if (scale != 1) s.pop_back();
+    }
+    uint64_t v = 0;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (s.empty() || ec != std::errc() || ptr != s.data() + s.size() || v > UINT64_MAX / scale) return false;
+    out = v * scale;
+    return true;
+}
+
 static bool has_flag(int argc, char* argv[], const std::string& flag) {
     for (int i = 1; i < argc; ++i) {
         if (std::string(argv[i]) == flag) return true;
@@ -78,8 +106,26 @@ int main(int argc, char* argv[]) {
                   << "Usage: the_third_eye [options]\n\n"
                   << "Options:\n"
                   << "  --port <int>          HTTP port for /metrics (default: 9100, env: TTE_PORT)\n"
-                  << "  --interval <sec>      Collection interval in seconds (default: 1, env: TTE_INTERVAL)\n"
-                  << "  --top-n <int>         Top N processes to track (default: 5, max: 10, env: TTE_TOP_N)\n"
+                  << "  --interval <dur>      Evaluation interval, e.g. 500ms, 1s, 2 (default: 1s, env: TTE_INTERVAL)\n"
+                  << "  --collector-deadline <sec>  Per-collector time budget per cycle (default: 1, env: TTE_COLLECTOR_DEADLINE)\n"
+                  << "  --collector-interval <name=dur,...>  Per-collector periods, e.g. cpu=250ms,process=5s\n"
+                  << "                        (defaults: cpu/memory 250, network/disk 1000, process 5000, system 60000; env: TTE_COLLECTOR_INTERVALS)\n"
+                  << "  --top-n <int>         Top N processes to track (default: 5, max: 500, env: TTE_TOP_N)\n"
+                  << "  --all-processes       Export every process to /metrics (env: TTE_ALL_PROCESSES=1)\n"
+                  << "  --process-budget <int>  Series per process metric with --all-processes; the rest\n"
+                  << "                        are summed into process=\"other\" (default: 1000, env: TTE_PROCESS_BUDGET)\n"
+                  << "  --group-by <name|tree>  Roll processes up by executable name, or by same-name\n"
+                  << "                        parent chain (default: name, env: TTE_GROUP_BY)\n"
+                  << "  --anomaly <name,...|*>  Flag series that stray from their own recent baseline\n"
+                  << "                        (\"*\" watches every gauge; default: off, env: TTE_ANOMALY)\n"
+                  << "  --anomaly-z <float>   Standard deviations that count as anomalous (default: 4, env: TTE_ANOMALY_Z)\n"
+                  << "  --anomaly-seasonal    Learn a baseline per hour of day (env: TTE_ANOMALY_SEASONAL=1)\n"
+                  << "  --rules <path>        Alert rules file; replaces the built-in cpu_high, memory_high,\n"
+                  << "                        collect_slow and cpu_core_saturated rules (env: TTE_RULES)\n"
+                  << "  --data-dir <path>     Keep metric history on disk in this directory, across restarts\n"
+                  << "                        (default: memory only, env: TTE_DATA_DIR)\n"
+                  << "  --data-retention <size>  Disk budget for --data-dir, e.g. 512MB, 2G; the oldest\n"
+                  << "                        segments are deleted past it (default: 512MB, env: TTE_DATA_RETENTION)\n"
                   << "  --log-level <level>   Log level: info|debug (default: info, env: TTE_LOG_LEVEL)\n"
                   << "  --help, -h            Show this help\n";
         return 0;
@@ -89,21 +135,89 @@ int main(int argc, char* argv[]) {
     third_eye::Agent::Config config;
 
     auto port_str     = get_arg(argc, argv, "--port",      "TTE_PORT",      "9100");
-    auto interval_str = get_arg(argc, argv, "--interval",  "TTE_INTERVAL",  "1");
+    auto interval_str = get_arg(argc, argv, "--interval",  "TTE_INTERVAL",  "1s");
     auto topn_str     = get_arg(argc, argv, "--top-n",     "TTE_TOP_N",     "5");
     auto log_str      = get_arg(argc, argv, "--log-level", "TTE_LOG_LEVEL", "info");
+    auto deadline_str = get_arg(argc, argv, "--collector-deadline", "TTE_COLLECTOR_DEADLINE", "1");
+    auto periods_str  = get_arg(argc, argv, "--collector-interval", "TTE_COLLECTOR_INTERVALS", "");
+    auto budget_str   = get_arg(argc, argv, "--process-budget", "TTE_PROCESS_BUDGET", "1000");
+    auto group_str    = get_arg(argc, argv, "--group-by", "TTE_GROUP_BY", "name");
+    auto anomaly_str  = get_arg(argc, argv, "--anomaly", "TTE_ANOMALY", "");
+    auto anomaly_z_str = get_arg(argc, argv, "--anomaly-z", "TTE_ANOMALY_Z", "4");
+    auto rules_path   = get_arg(argc, argv, "--rules", "TTE_RULES", "");
+    auto data_dir     = get_arg(argc, argv, "--data-dir", "TTE_DATA_DIR", "");
+    auto retention_str = get_arg(argc, argv, "--data-retention", "TTE_DATA_RETENTION", "512MB");
 
     try {
         config.port     = static_cast<uint16_t>(std::stoi(port_str));
-        config.interval = std::stoi(interval_str);
-        config.top_n    = std::clamp(std::stoi(topn_str), 1, 10);
+        config.top_n    = std::clamp(std::stoi(topn_str), 1, third_eye::Agent::MAX_TOP_N);
+        config.collector_deadline = std::stod(deadline_str);
+        config.process_budget = static_cast<size_t>(std::max(std::stoi(budget_str), 2));
+        config.anomaly_z = std::stod(anomaly_z_str);
     } catch (...) {
-        std::cerr << "Error: invalid --port, --interval, or --top-n value.\n";
+        std::cerr << "Error: invalid --port, --top-n, --collector-deadline, --process-budget or --anomaly-z value.\n";
+        return 1;
+    }
+
+    int64_t interval_ms = 0;
+    if (!third_eye::parse_duration_ms(interval_str, interval_ms) ||
+        interval_ms < third_eye::Agent::MIN_INTERVAL_MS || interval_ms > third_eye::Agent::MAX_INTERVAL_MS) {
+        std::cerr << "Error: --interval must be between 10ms and 1h.\n";
+        return 1;
+    }
+    config.interval_ms = static_cast<uint32_t>(interval_ms);
+
+    if (config.collector_deadline <= 0.0) {
+        std::cerr << "Error: --collector-deadline must be > 0.\n";
+        return 1;
+    }
+
+    // name=duration pairs, comma separated
+    for (size_t pos = 0; pos < periods_str.size();) {
+        auto comma = periods_str.find(',', pos);
+        if (comma == std::string::npos) comma = periods_str.size();
+        std::string item = periods_str.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (item.empty()) continue;
+
+        // Bare numbers are milliseconds here, as in POST /api/config.
+        auto eq = item.find('=');
+        int64_t ms = 0;
+        if (eq == std::string::npos || !third_eye::parse_duration_ms(item.substr(eq + 1), ms, 1.0) || ms <= 0) {
+            std::cerr << "Error: invalid --collector-interval entry '" << item << "'.\n";
+            return 1;
+        }
+        config.collector_intervals_ms[item.substr(0, eq)] = static_cast<uint32_t>(ms);
+    }
+
+    const char* all_env = std::getenv("TTE_ALL_PROCESSES");
+    config.export_all_processes = has_flag(argc, argv, "--all-processes") ||
+                                  (all_env && std::string(all_env) == "1");
+
+    if (group_str != "name" && group_str != "tree") {
+        std::cerr << "Error: --group-by must be 'name' or 'tree'.\n";
         return 1;
     }
+    config.group_by_tree = group_str == "tree";
 
-    if (config.interval <= 0) {
-        std::cerr << "Error: --interval must be > 0.\n";
+    if (config.anomaly_z <= 0.0) {
+        std::cerr << "Error: --anomaly-z must be > 0.\n";
+        return 1;
+    }
+    for (size_t pos = 0; pos < anomaly_str.size();) {
+        auto comma = anomaly_str.find(',', pos);
+        if (comma == std::string::npos) comma = anomaly_str.size();
+        if (comma > pos) config.anomaly_metrics.push_back(anomaly_str.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    const char* seasonal_env = std::getenv("TTE_ANOMALY_SEASONAL");
+    config.anomaly_seasonal = has_flag(argc, argv, "--anomaly-seasonal") ||
+                              (seasonal_env && std::string(seasonal_env) == "1");
+
+    config.rules_path = rules_path;
+    config.data_dir   = data_dir;
+    if (!parse_size_bytes(retention_str, config.data_retention_bytes) || config.data_retention_bytes == 0) {
+        std::cerr << "Error: invalid --data-retention value '" << retention_str << "'.\n";
         return 1;
     }
 
@@ -115,6 +229,20 @@ int main(int argc, char* argv[]) {
     third_eye::Agent agent(config);
     g_agent = &agent;
 
+    if (!rules_path.empty()) {
+        std::ifstream f(rules_path, std::ios::binary);
+        if (!f) {
+            std::cerr << "Error: cannot read --rules file '" << rules_path << "'.\n";
+            return 1;
+        }
+        std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        std::string error;
+        if (!agent.load_alert_rules(text, error)) {
+            std::cerr << "Error: " << rules_path << ": " << error << "\n";
+            return 1;
+        }
+    }
+
 
     std::signal(SIGINT,  signal_handler);
     std::signal(SIGTERM, signal_handler);
@@ -124,11 +252,13 @@ int main(int argc, char* argv[]) {
 #endif
 
 
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
     agent.add_collector(create_cpu_collector());
     agent.add_collector(create_memory_collector());
     agent.add_collector(create_system_collector());
     agent.add_collector(create_process_collector(config.top_n, &agent));
+    agent.add_collector(create_network_collector());
+    agent.add_collector(create_disk_collector());
 #else
     agent.log_info("No collectors available for this platform yet.");
 #endif
@@ -1,30 +1,105 @@
 #include "third_eye/registry.hpp"
+#include "third_eye/snapshot_format.hpp"
 
-#include <sstream>
-#include <iomanip>
 #include <cmath>
 #include <mutex>
-#include <locale>
+#include <bit>
+#include <charconv>
+#include <cstring>
 
 namespace third_eye {
 
+size_t ShardedCounter::shard_index() {
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return index;
+}
+
 void Registry::register_metric(const std::string& name, MetricType type, const std::string& help) {
     std::unique_lock lock(mutex_);
     if (metrics_.contains(name)) return;
     order_.push_back(name);
     // Create with a default unlabeled series (value 0) so it always appears in snapshot
-    metrics_[name] = MetricEntry{type, help, {MetricSeries{"", 0.0}}};
+    auto& entry = metrics_[name];
+    entry.type   = type;
+    entry.help   = help;
+    entry.header = "# HELP " + name + " " + help + "\n# TYPE " + name + " " +
+                   (type == MetricType::Gauge ? "gauge" : "counter") + "\n";
+    claim_series(entry, name, "", 0.0);
+}
+
+MetricSeries* Registry::find_series(const std::string& name, const std::string& labels) const {
+    auto it = metrics_.find(name);
+    if (it == metrics_.end()) return nullptr;
+
+    auto s = it->second.index.find(labels);
+    return s == it->second.index.end() ? nullptr : s->second;
 }
 
 MetricSeries* Registry::find_or_create_series(const std::string& name, const std::string& labels) {
     auto it = metrics_.find(name);
     if (it == metrics_.end()) return nullptr;
 
-    for (auto& s : it->second.series) {
-        if (s.labels == labels) return &s;
+    if (auto s = it->second.index.find(labels); s != it->second.index.end()) return s->second;
+    return &claim_series(it->second, name, labels, 0.0);
+}
+
+MetricSeries& Registry::claim_series(MetricEntry& entry, const std::string& name,
+                                     std::string_view labels, double value) {
+    layout_dirty_.store(true);
+    entry.epoch = layout_epoch_.fetch_add(1, std::memory_order_relaxed) + 1;
+    MetricSeries* s = nullptr;
+    if (entry.free > 0) {
+        for (auto& candidate : entry.series) {
+            if (!candidate.active) { s = &candidate; break; }
+        }
     }
-    it->second.series.push_back(MetricSeries{labels, 0.0});
-    return &it->second.series.back();
+    if (s) {
+        --entry.free;
+        s->labels = labels;
+        s->prefix = name + s->labels + ' ';
+        s->value.store(value, std::memory_order_relaxed);
+        if (s->counter) {
+            s->counter = std::make_unique<ShardedCounter>();
+            s->counter->add(value);
+        }
+        s->rendered = false;
+        s->active   = true;
+    } else {
+        s = &entry.series.emplace_back(name, std::string(labels), value, entry.type);
+    }
+    s->id      = next_series_id_++;
+    s->touched = replace_pass_;
+    entry.index.emplace(s->labels, s);
+    ++entry.active;
+    return *s;
+}
+
+MetricSeries* Registry::resolve(const std::string& name, const std::string& labels, MetricType type) {
+    std::unique_lock lock(mutex_);
+    auto it = metrics_.find(name);
+    if (it == metrics_.end() || it->second.type != type) return nullptr;
+    return find_or_create_series(name, labels);
+}
+
+GaugeHandle Registry::register_gauge(const std::string& name, const std::string& help,
+                                     const std::string& labels) {
+    register_metric(name, MetricType::Gauge, help);
+    return gauge_handle(name, labels);
+}
+
+CounterHandle Registry::register_counter(const std::string& name, const std::string& help,
+                                         const std::string& labels) {
+    register_metric(name, MetricType::Counter, help);
+    return counter_handle(name, labels);
+}
+
+GaugeHandle Registry::gauge_handle(const std::string& name, const std::string& labels) {
+    return GaugeHandle(resolve(name, labels, MetricType::Gauge));
+}
+
+CounterHandle Registry::counter_handle(const std::string& name, const std::string& labels) {
+    return CounterHandle(resolve(name, labels, MetricType::Counter));
 }
 
 void Registry::gauge_set(const std::string& name, double value) {
@@ -32,23 +107,81 @@ void Registry::gauge_set(const std::string& name, double value) {
 }
 
 void Registry::gauge_set(const std::string& name, const std::string& labels, double value) {
+    {
+        // Existing series: values are atomic, a shared lock is enough.
+        std::shared_lock lock(mutex_);
+        if (auto* s = find_series(name, labels)) {
+            s->value.store(value, std::memory_order_relaxed);
+            return;
+        }
+    }
     std::unique_lock lock(mutex_);
     auto* s = find_or_create_series(name, labels);
-    if (s) s->value = value;
+    if (s) s->value.store(value, std::memory_order_relaxed);
 }
 
 void Registry::gauge_replace_all(const std::string& name,
                                   const std::vector<std::pair<std::string, double>>& entries) {
+    replace_all(name, entries);
+}
+
+void Registry::gauge_replace_all(const std::string& name,
+                                  const std::vector<std::pair<std::string_view, double>>& entries) {
+    replace_all(name, entries);
+}
+
+template <typename Entries>
+void Registry::replace_all(const std::string& name, const Entries& entries) {
+    {
+        // Same label sets as last time (the steady state): values only.
+        std::shared_lock lock(mutex_);
+        auto it = metrics_.find(name);
+        if (it == metrics_.end()) return;
+        auto& entry = it->second;
+
+        bool same = entry.active == entries.size();
+        for (size_t i = 0; same && i < entries.size(); ++i) {
+            same = entry.index.contains(std::string_view(entries[i].first));
+        }
+        if (same) {
+            for (const auto& [labels, value] : entries) {
+                entry.index.find(std::string_view(labels))->second->value.store(value, std::memory_order_relaxed);
+            }
+            return;
+        }
+    }
+
     std::unique_lock lock(mutex_);
     auto it = metrics_.find(name);
     if (it == metrics_.end()) return;
+    auto& entry = it->second;
+    uint32_t pass = ++replace_pass_;
 
-    std::vector<MetricSeries> new_series;
-    new_series.reserve(entries.size());
+    // Label sets that survive keep their series and id, so history stays continuous.
     for (const auto& [labels, value] : entries) {
-        new_series.push_back(MetricSeries{labels, value});
+        if (auto found = entry.index.find(std::string_view(labels)); found != entry.index.end()) {
+            found->second->value.store(value, std::memory_order_relaxed);
+            found->second->touched = pass;
+        } else {
+            claim_series(entry, name, labels, value);
+        }
+    }
+
+    for (auto& s : entry.series) {
+        if (!s.active || s.touched == pass) continue;
+        entry.index.erase(std::string_view(s.labels));
+        s.active = false;
+        --entry.active;
+        ++entry.free;
+        layout_dirty_.store(true);
+        entry.epoch = layout_epoch_.fetch_add(1, std::memory_order_relaxed) + 1;
     }
-    it->second.series = std::move(new_series);
+}
+
+uint64_t Registry::metric_epoch(const std::string& name) const {
+    std::shared_lock lock(mutex_);
+    auto it = metrics_.find(name);
+    return it == metrics_.end() ? 0 : it->second.epoch;
 }
 
 void Registry::counter_inc(const std::string& name, double delta) {
@@ -56,42 +189,109 @@ void Registry::counter_inc(const std::string& name, double delta) {
 }
 
 void Registry::counter_inc(const std::string& name, const std::string& labels, double delta) {
+    {
+        std::shared_lock lock(mutex_);
+        auto it = metrics_.find(name);
+        if (it == metrics_.end() || it->second.type != MetricType::Counter) return;
+        if (auto* s = find_series(name, labels)) {
+            s->counter->add(delta);
+            return;
+        }
+    }
     std::unique_lock lock(mutex_);
-    auto it = metrics_.find(name);
-    if (it == metrics_.end() || it->second.type != MetricType::Counter) return;
     auto* s = find_or_create_series(name, labels);
-    if (s) s->value += delta;
+    if (s) s->counter->add(delta);
 }
 
-std::string Registry::serialize() const {
+/// Formats a sample value the way the exposition always has: integral
+/// values without decimals, everything else with six fixed decimals.
+static size_t format_value(double val, char* buf, size_t cap) {
+    char* end = buf + cap;
+    std::to_chars_result r{};
+    if (std::isnan(val)) {
+        std::memcpy(buf, "NaN", 3);
+        return 3;
+    } else if (std::isinf(val)) {
+        std::memcpy(buf, val > 0 ? "+Inf" : "-Inf", 4);
+        return 4;
+    } else if (val == std::floor(val) && std::abs(val) < 1e15) {
+        r = std::to_chars(buf, end, static_cast<long long>(val));
+    } else if (std::abs(val) < 1e15) {
+        r = std::to_chars(buf, end, val, std::chars_format::fixed, 6);
+    } else {
+        r = std::to_chars(buf, end, val);
+    }
+    return static_cast<size_t>(r.ptr - buf);
+}
+
+Exposition Registry::exposition() const {
     std::shared_lock lock(mutex_);
-    std::ostringstream out;
-    out.imbue(std::locale::classic());
-    out << std::fixed << std::setprecision(6);
+    std::lock_guard cache_lock(cache_mutex_);
+
+    bool rebuild = layout_dirty_.exchange(false) || !exposition_;
+    bool patched = false;
 
     for (const auto& name : order_) {
         auto it = metrics_.find(name);
         if (it == metrics_.end()) continue;
 
-        const auto& entry = it->second;
-        const char* type_str = (entry.type == MetricType::Gauge) ? "gauge" : "counter";
+        for (const auto& s : it->second.series) {
+            if (!s.active) continue;
+            double   val  = s.current();
+            uint64_t bits = std::bit_cast<uint64_t>(val);
+            if (s.rendered && bits == s.rendered_bits) continue;
+
+            char   text[sizeof(s.value_text)];
+            size_t len      = format_value(val, text, sizeof(text));
+            bool   same_len = s.rendered && len == s.value_len;
+
+            std::memcpy(s.value_text, text, len);
+            s.value_len     = static_cast<uint8_t>(len);
+            s.rendered_bits = bits;
+            s.rendered      = true;
+
+            if (rebuild) continue;
+            if (!same_len) { rebuild = true; continue; }
 
-        out << "# HELP " << name << " " << entry.help << "\n";
-        out << "# TYPE " << name << " " << type_str << "\n";
+            // Patch in place, unless a response is still holding this buffer.
+            if (exposition_.use_count() > 1)
+                exposition_ = std::make_shared<std::string>(*exposition_);
+            std::memcpy(exposition_->data() + s.value_offset, text, len);
+            patched = true;
+        }
+    }
+
+    if (rebuild) {
+        auto buf = std::make_shared<std::string>();
+        buf->reserve(exposition_ ? exposition_->size() + 256 : 4096);
 
-        for (const auto& s : entry.series) {
-            out << name << s.labels << " ";
-            double val = s.value;
-            if (val == std::floor(val) && std::abs(val) < 1e15) {
-                out << static_cast<long long>(val);
-            } else {
-                out << val;
+        for (const auto& name : order_) {
+            auto it = metrics_.find(name);
+            if (it == metrics_.end()) continue;
+
+            *buf += it->second.header;
+            for (const auto& s : it->second.series) {
+                if (!s.active) continue;
+                *buf += s.prefix;
+                s.value_offset = buf->size();
+                buf->append(s.value_text, s.value_len);
+                *buf += '\n';
             }
-            out << "\n";
         }
+        exposition_ = std::move(buf);
     }
+    if (rebuild || patched) ++exposition_version_;
 
-    return out.str();
+    return {exposition_, exposition_version_};
+}
+
+Exposition Registry::last_exposition() const {
+    std::lock_guard cache_lock(cache_mutex_);
+    return {exposition_, exposition_version_};
+}
+
+std::string Registry::serialize() const {
+    return *exposition().body;
 }
 
 std::vector<MetricSnapshot> Registry::snapshot() const {
@@ -101,10 +301,56 @@ std::vector<MetricSnapshot> Registry::snapshot() const {
         auto it = metrics_.find(name);
         if (it == metrics_.end()) continue;
         for (const auto& s : it->second.series) {
-            result.push_back({name, s.labels, s.value});
+            if (s.active) result.push_back({name, s.labels, s.current()});
         }
     }
     return result;
 }
 
+void Registry::encode_snapshot(std::string& out, uint64_t known_epoch, uint64_t timestamp_ms) const {
+    std::shared_lock lock(mutex_);
+    uint64_t epoch      = layout_epoch_.load(std::memory_order_relaxed);
+    bool     with_names = known_epoch != epoch;
+
+    size_t count = 0;
+    for (const auto& [name, entry] : metrics_) count += entry.active;
+
+    // Sized for the common case (short ids, no name table) so the value
+    // loop does not reallocate.
+    out.reserve(out.size() + 32 + count * 12);
+    out.append(snapshot::MAGIC, sizeof(snapshot::MAGIC));
+    out.push_back(static_cast<char>(snapshot::VERSION));
+    out.push_back(static_cast<char>(with_names ? snapshot::FLAG_NAMES : 0));
+    snapshot::put_varint(out, epoch);
+    snapshot::put_varint(out, timestamp_ms);
+
+    if (with_names) {
+        snapshot::put_varint(out, count);
+        for (const auto& name : order_) {
+            auto it = metrics_.find(name);
+            if (it == metrics_.end()) continue;
+            auto type = it->second.type == MetricType::Counter ? snapshot::SeriesType::Counter
+                                                               : snapshot::SeriesType::Gauge;
+            for (const auto& s : it->second.series) {
+                if (!s.active) continue;
+                snapshot::put_varint(out, s.id);
+                out.push_back(static_cast<char>(type));
+                snapshot::put_string(out, name);
+                snapshot::put_string(out, s.labels);
+            }
+        }
+    }
+
+    snapshot::put_varint(out, count);
+    for (const auto& name : order_) {
+        auto it = metrics_.find(name);
+        if (it == metrics_.end()) continue;
+        for (const auto& s : it->second.series) {
+            if (!s.active) continue;
+            snapshot::put_varint(out, s.id);
+            snapshot::put_double(out, s.current());
+        }
+    }
+}
+
 }
@@ -0,0 +1,801 @@
+#include "third_eye/segment_store.hpp"
+#include "third_eye/registry.hpp"
+#include "third_eye/snapshot_format.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace third_eye {
+
+namespace {
+
+// --- On-disk format ------------------------------------------------------------
+//
+//   header   4 KiB: magic "TTESEG01", u32 version, u32 block bytes,
+//            u32 block count, u32 reserved, u64 segment seq, i64 created ms,
+//            u32 CRC-32 of the preceding 40 bytes; the rest is zero
+//   blocks   block count x block bytes, each a run of records followed by
+//            zeroes (a record length of 0 ends the block)
+//   record   u32 payload length, u32 CRC-32 of the payload, payload
+//
+// Payloads (varints and strings as in snapshot_format.hpp):
+//   series   u8 1, varint series number, name, labels
+//   samples  u8 2, u8 flags (bit 0: keyframe), varint timestamp ms,
+//            varint count, then per series: varint series number, f64 value,
+//            varint removed count, then that many series numbers
+//
+// Series numbers are local to a segment and assigned in order. A keyframe
+// lists every live series and starts each block. Other samples records list
+// only the series whose value changed; the rest keep their last value until
+// they are removed.
+//
+// Integers in the header are little-endian.
+
+constexpr char     SEGMENT_MAGIC[8] = {'T', 'T', 'E', 'S', 'E', 'G', '0', '1'};
+constexpr char     INDEX_MAGIC[8]   = {'T', 'T', 'E', 'I', 'D', 'X', '0', '1'};
+constexpr uint32_t FORMAT_VERSION   = 1;
+constexpr size_t   HEADER_BYTES     = 4096;
+constexpr size_t   RECORD_HEADER    = 8;
+
+constexpr uint8_t  RECORD_SERIES  = 1;
+constexpr uint8_t  RECORD_SAMPLES = 2;
+constexpr uint8_t  FLAG_KEYFRAME  = 0x01;
+
+constexpr int64_t  OPEN_ENDED = std::numeric_limits<int64_t>::max();   // Series still live
+constexpr int64_t  NO_TIME    = std::numeric_limits<int64_t>::min();
+
+constexpr std::array<uint32_t, 256> CRC_TABLE = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        t[i] = c;
+    }
+    return t;
+}();
+
+uint32_t crc32(const char* data, size_t len) {
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i)
+        c = CRC_TABLE[(c ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+void store_u32(char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<char>(v >> (8 * i));
+}
+void store_u64(char* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<char>(v >> (8 * i));
+}
+uint32_t load_u32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return v;
+}
+
+std::filesystem::path segment_path(const std::filesystem::path& dir, uint64_t seq, const char* ext) {
+    char name[32];
+    auto r = std::to_chars(name, name + 16, seq, 16);
+    size_t len = static_cast<size_t>(r.ptr - name);
+    std::string file(16 - len, '0');
+    file.append(name, len);
+    file += ext;
+    return dir / file;
+}
+
+
+/// A file mapped into memory in full. Writable mappings create the file or
+/// extend it to the requested size first.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// `size` 0 maps the file at its current size (read-only use).
+    bool open(const std::filesystem::path& path, size_t size, bool writable) {
+        close();
+#ifdef _WIN32
+        file_ = CreateFileW(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                            writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER cur{};
+        if (!GetFileSizeEx(file_, &cur)) { close(); return false; }
+        if (writable && static_cast<uint64_t>(cur.QuadPart) < size) {
+            LARGE_INTEGER want{};
+            want.QuadPart = static_cast<LONGLONG>(size);
+            if (!SetFilePointerEx(file_, want, nullptr, FILE_BEGIN) || !SetEndOfFile(file_)) { close(); return false; }
+        } else {
+            size = static_cast<size_t>(cur.QuadPart);
+        }
+        if (size == 0) { close(); return false; }
+        mapping_ = CreateFileMappingW(file_, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                      static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                      static_cast<DWORD>(size), nullptr);
+        if (!mapping_) { close(); return false; }
+        void* p = MapViewOfFile(mapping_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+        if (!p) { close(); return false; }
+#else
+        fd_ = ::open(path.c_str(), (writable ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC, 0644);
+        if (fd_ < 0) return false;
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0) { close(); return false; }
+        if (writable && static_cast<uint64_t>(st.st_size) < size) {
+            // Sparse: blocks take disk space only once they are written.
+            if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) { close(); return false; }
+        } else {
+            size = static_cast<size_t>(st.st_size);
+        }
+        if (size == 0) { close(); return false; }
+        void* p = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) { close(); return false; }
+#endif
+        data_     = static_cast<char*>(p);
+        size_     = size;
+        writable_ = writable;
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_    = INVALID_HANDLE_VALUE;
+#else
+        if (data_) ::munmap(data_, size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    /// Starts writing back [off, off + len); with `wait`, blocks until it is on disk.
+    void flush(size_t off, size_t len, bool wait) {
+        if (!data_ || !writable_ || len == 0) return;
+#ifdef _WIN32
+        FlushViewOfFile(data_ + off, len);
+        if (wait) FlushFileBuffers(file_);
+#else
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t start = off / page * page;
+        ::msync(data_ + start, off + len - start, wait ? MS_SYNC : MS_ASYNC);
+#endif
+    }
+
+    [[nodiscard]] char*  data() const { return data_; }
+    [[nodiscard]] size_t size() const { return size_; }
+
+private:
+    char*  data_     = nullptr;
+    size_t size_     = 0;
+    bool   writable_ = false;
+#ifdef _WIN32
+    HANDLE file_    = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int    fd_ = -1;
+#endif
+};
+
+}
+
+
+struct SegmentStore::Segment {
+    struct SeriesEntry {
+        std::string name;
+        std::string labels;
+        int64_t     first_ts = OPEN_ENDED;   // First sample; OPEN_ENDED until one is written
+        int64_t     last_ts  = OPEN_ENDED;   // Last sample; OPEN_ENDED while live
+    };
+    struct Block {
+        uint32_t used     = 0;
+        int64_t  first_ts = OPEN_ENDED;
+        int64_t  last_ts  = NO_TIME;
+    };
+
+    uint64_t    seq = 0;
+    MappedFile  file;
+    size_t      block_bytes = 0;
+    uint32_t    block_count = 0;
+    std::vector<SeriesEntry> series;   // Indexed by series number
+    std::vector<Block>       blocks;   // block_count entries
+    uint32_t    head    = 0;           // Block being appended to
+    int64_t     last_ts = NO_TIME;     // Newest samples record
+    bool        sealed  = false;
+
+    [[nodiscard]] char* block(uint32_t b) const { return file.data() + HEADER_BYTES + b * block_bytes; }
+    [[nodiscard]] int64_t first_ts() const { return blocks.empty() ? OPEN_ENDED : blocks[0].first_ts; }
+    [[nodiscard]] size_t file_bytes() const { return HEADER_BYTES + block_bytes * block_count; }
+
+    /// Reads the header; false if it is not a segment of a known version.
+    bool read_header() {
+        const char* h = file.data();
+        if (file.size() < HEADER_BYTES || std::memcmp(h, SEGMENT_MAGIC, 8) != 0) return false;
+        if (load_u32(h + 8) != FORMAT_VERSION || load_u32(h + 40) != crc32(h, 40)) return false;
+        block_bytes = load_u32(h + 12);
+        block_count = load_u32(h + 16);
+        if (block_bytes < 4096 || block_count == 0 || file_bytes() > file.size()) return false;
+        blocks.assign(block_count, Block{});
+        return true;
+    }
+
+    void write_header(int64_t created_ms) {
+        char* h = file.data();
+        std::memcpy(h, SEGMENT_MAGIC, 8);
+        store_u32(h + 8, FORMAT_VERSION);
+        store_u32(h + 12, static_cast<uint32_t>(block_bytes));
+        store_u32(h + 16, block_count);
+        store_u32(h + 20, 0);
+        store_u64(h + 24, seq);
+        store_u64(h + 32, static_cast<uint64_t>(created_ms));
+        store_u32(h + 40, crc32(h, 40));
+        file.flush(0, HEADER_BYTES, false);
+    }
+
+    /// Rebuilds the index from the records. With `repair`, everything from
+    /// the first bad record on is zeroed, so appends resume after the last
+    /// good one; head is then the first block that is still empty.
+    void scan(bool repair) {
+        series.clear();
+        blocks.assign(block_count, Block{});
+        last_ts = NO_TIME;
+        std::vector<uint8_t> alive;
+        std::vector<uint8_t> in_keyframe;
+
+        uint32_t b = 0;
+        for (; b < block_count; ++b) {
+            char*  base = block(b);
+            size_t off  = 0;
+            bool   bad  = false;
+            while (off + RECORD_HEADER <= block_bytes) {
+                uint32_t len = load_u32(base + off);
+                if (len == 0) break;
+                if (len > block_bytes - off - RECORD_HEADER ||
+                    load_u32(base + off + 4) != crc32(base + off + RECORD_HEADER, len) ||
+                    !apply(std::string_view(base + off + RECORD_HEADER, len), blocks[b], alive, in_keyframe)) {
+                    bad = true;
+                    break;
+                }
+                off += RECORD_HEADER + len;
+            }
+            blocks[b].used = static_cast<uint32_t>(off);
+
+            if (bad && repair) {
+                std::memset(base + off, 0, block_bytes - off);
+                file.flush(HEADER_BYTES + b * block_bytes, block_bytes, false);
+            }
+            if (bad || off == 0) break;
+        }
+        head = std::min(b + (b < block_count && blocks[b].used > 0 ? 1u : 0u), block_count);
+
+        if (repair) {
+            // Blocks past the cut may hold records of an earlier life of the file.
+            for (uint32_t k = b + 1; k < block_count; ++k) {
+                if (load_u32(block(k)) == 0) continue;
+                std::memset(block(k), 0, block_bytes);
+                file.flush(HEADER_BYTES + k * block_bytes, block_bytes, false);
+            }
+        }
+    }
+
+    /// Applies one record to the index; false if it is malformed.
+    bool apply(std::string_view payload, Block& blk, std::vector<uint8_t>& alive,
+               std::vector<uint8_t>& in_keyframe) {
+        snapshot::Reader r(payload);
+        uint8_t type;
+        if (!r.get_u8(type)) return false;
+
+        if (type == RECORD_SERIES) {
+            uint64_t ref;
+            SeriesEntry e;
+            if (!r.get_varint(ref) || ref != series.size() || !r.get_string(e.name) || !r.get_string(e.labels))
+                return false;
+            series.push_back(std::move(e));
+            alive.push_back(0);
+            in_keyframe.push_back(0);
+            return true;
+        }
+        if (type != RECORD_SAMPLES) return false;
+
+        uint8_t  flags;
+        uint64_t ts, count;
+        if (!r.get_u8(flags) || !r.get_varint(ts) || !r.get_varint(count)) return false;
+        auto t = static_cast<int64_t>(ts);
+        bool keyframe = flags & FLAG_KEYFRAME;
+
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t ref;
+            double   v;
+            if (!r.get_varint(ref) || ref >= series.size() || !r.get_double(v)) return false;
+            if (series[ref].first_ts == OPEN_ENDED) series[ref].first_ts = t;
+            series[ref].last_ts = OPEN_ENDED;
+            alive[ref] = 1;
+            if (keyframe) in_keyframe[ref] = 1;
+        }
+        if (keyframe) {
+            // Anything not in a keyframe ended with the previous record.
+            for (size_t s = 0; s < series.size(); ++s) {
+                if (alive[s] && !in_keyframe[s]) {
+                    alive[s] = 0;
+                    series[s].last_ts = last_ts;
+                }
+                in_keyframe[s] = 0;
+            }
+        }
+        uint64_t removed;
+        if (!r.get_varint(removed)) return false;
+        for (uint64_t i = 0; i < removed; ++i) {
+            uint64_t ref;
+            if (!r.get_varint(ref) || ref >= series.size()) return false;
+            alive[ref] = 0;
+            series[ref].last_ts = last_ts;
+        }
+
+        blk.first_ts = std::min(blk.first_ts, t);
+        blk.last_ts  = t;
+        last_ts      = t;
+        return true;
+    }
+
+    /// Closes the time range of every live series at the last record.
+    void close_series() {
+        for (auto& s : series) {
+            if (s.last_ts == OPEN_ENDED) s.last_ts = last_ts;
+        }
+    }
+
+    std::filesystem::path index_path(const std::filesystem::path& dir) const {
+        return segment_path(dir, seq, ".idx");
+    }
+
+    bool write_index(const std::filesystem::path& dir) const {
+        std::string out(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        snapshot::put_varint(out, seq);
+        snapshot::put_varint(out, series.size());
+        for (const auto& s : series) {
+            snapshot::put_string(out, s.name);
+            snapshot::put_string(out, s.labels);
+            snapshot::put_varint(out, static_cast<uint64_t>(s.first_ts));
+            snapshot::put_varint(out, static_cast<uint64_t>(s.last_ts));
+        }
+        uint32_t used = 0;
+        while (used < block_count && blocks[used].used > 0) ++used;
+        snapshot::put_varint(out, used);
+        for (uint32_t b = 0; b < used; ++b) {
+            snapshot::put_varint(out, blocks[b].used);
+            snapshot::put_varint(out, static_cast<uint64_t>(blocks[b].first_ts));
+            snapshot::put_varint(out, static_cast<uint64_t>(blocks[b].last_ts));
+        }
+        char crc[4];
+        store_u32(crc, crc32(out.data(), out.size()));
+        out.append(crc, sizeof(crc));
+
+        // Written aside and renamed, so a crash never leaves half an index.
+        auto path = index_path(dir);
+        auto tmp  = path;
+        tmp += ".tmp";
+        {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            if (!f.write(out.data(), static_cast<std::streamsize>(out.size()))) return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        return !ec;
+    }
+
+    bool read_index(const std::filesystem::path& dir) {
+        std::ifstream f(index_path(dir), std::ios::binary);
+        if (!f) return false;
+        std::string in((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        if (in.size() < sizeof(INDEX_MAGIC) + 4 || std::memcmp(in.data(), INDEX_MAGIC, 8) != 0) return false;
+        size_t body = in.size() - 4;
+        if (load_u32(in.data() + body) != crc32(in.data(), body)) return false;
+
+        snapshot::Reader r(std::string_view(in.data() + 8, body - 8));
+        uint64_t file_seq, n;
+        if (!r.get_varint(file_seq) || file_seq != seq || !r.get_varint(n)) return false;
+        series.clear();
+        for (uint64_t i = 0; i < n; ++i) {
+            SeriesEntry e;
+            uint64_t first, last;
+            if (!r.get_string(e.name) || !r.get_string(e.labels) || !r.get_varint(first) || !r.get_varint(last))
+                return false;
+            e.first_ts = static_cast<int64_t>(first);
+            e.last_ts  = static_cast<int64_t>(last);
+            series.push_back(std::move(e));
+        }
+        if (!r.get_varint(n) || n > block_count) return false;
+        blocks.assign(block_count, Block{});
+        for (uint64_t b = 0; b < n; ++b) {
+            uint64_t used, first, last;
+            if (!r.get_varint(used) || used > block_bytes || !r.get_varint(first) || !r.get_varint(last))
+                return false;
+            blocks[b] = {static_cast<uint32_t>(used), static_cast<int64_t>(first), static_cast<int64_t>(last)};
+            last_ts = blocks[b].last_ts;
+        }
+        head = static_cast<uint32_t>(n);
+        return true;
+    }
+};
+
+
+SegmentStore::SegmentStore(Options options) : options_(std::move(options)) {
+    options_.block_bytes        = std::max<size_t>(options_.block_bytes, 4096);
+    options_.blocks_per_segment = std::max<uint32_t>(options_.blocks_per_segment, 1);
+
+    std::error_code ec;
+    std::filesystem::create_directories(options_.dir, ec);
+    if (!std::filesystem::is_directory(options_.dir))
+        throw std::runtime_error("cannot create data directory " + options_.dir.string());
+
+    open_existing();
+    bool writable = !segments_.empty() && !segments_.back()->sealed &&
+                    segments_.back()->head < segments_.back()->block_count;
+    if (!writable && !start_segment())
+        throw std::runtime_error("cannot create a segment in " + options_.dir.string());
+    enforce_retention();
+}
+
+SegmentStore::~SegmentStore() {
+    std::unique_lock lock(mutex_);
+    if (!segments_.empty()) {
+        auto& seg = *segments_.back();
+        seg.file.flush(0, seg.file.size(), true);
+    }
+}
+
+void SegmentStore::open_existing() {
+    std::vector<uint64_t> seqs;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(options_.dir, ec)) {
+        const auto& p = entry.path();
+        if (p.extension() != ".seg") continue;
+        std::string stem = p.stem().string();
+        uint64_t seq = 0;
+        auto [ptr, err] = std::from_chars(stem.data(), stem.data() + stem.size(), seq, 16);
+        if (err != std::errc{} || ptr != stem.data() + stem.size() || stem.size() != 16) continue;
+        seqs.push_back(seq);
+    }
+    std::sort(seqs.begin(), seqs.end());
+
+    for (size_t i = 0; i < seqs.size(); ++i) {
+        bool newest = (i + 1 == seqs.size());
+        auto seg = std::make_unique<Segment>();
+        seg->seq = seqs[i];
+        next_seq_ = std::max(next_seq_, seqs[i] + 1);
+
+        auto path = segment_path(options_.dir, seg->seq, ".seg");
+        if (!seg->file.open(path, 0, newest) || !seg->read_header()) {
+            seg->file.close();
+            std::filesystem::remove(path, ec);
+            std::filesystem::remove(seg->index_path(options_.dir), ec);
+            continue;
+        }
+
+        if (newest) {
+            // Possibly cut short by a crash: trust nothing, rescan and repair.
+            // The writer starts over with new series numbers, so the old ones end here.
+            seg->scan(true);
+            seg->close_series();
+        } else if (!seg->read_index(options_.dir)) {
+            seg->scan(false);
+            seg->close_series();
+            seg->write_index(options_.dir);
+        }
+        seg->sealed = !newest;
+        segments_.push_back(std::move(seg));
+    }
+}
+
+bool SegmentStore::start_segment() {
+    if (!segments_.empty() && !segments_.back()->sealed) seal(*segments_.back());
+
+    auto seg = std::make_unique<Segment>();
+    seg->seq         = next_seq_++;
+    seg->block_bytes = options_.block_bytes;
+    seg->block_count = options_.blocks_per_segment;
+    seg->blocks.assign(seg->block_count, Segment::Block{});
+    if (!seg->file.open(segment_path(options_.dir, seg->seq, ".seg"), seg->file_bytes(), true)) return false;
+
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    seg->write_header(now_ms);
+    segments_.push_back(std::move(seg));
+
+    // Series numbers start over in every segment.
+    for (auto& [id, k] : known_) {
+        k.ref   = NO_REF;
+        k.alive = false;
+    }
+    enforce_retention();
+    return true;
+}
+
+void SegmentStore::seal(Segment& seg) {
+    seg.close_series();
+    seg.file.flush(0, seg.file.size(), false);
+    seg.write_index(options_.dir);
+    seg.sealed = true;
+}
+
+void SegmentStore::enforce_retention() {
+    uint64_t total = 0;
+    for (const auto& s : segments_) total += s->file_bytes();
+
+    // Never drop the segment being written, nor the one before it.
+    std::error_code ec;
+    while (segments_.size() > 2 && total > options_.max_bytes) {
+        auto& oldest = segments_.front();
+        total -= oldest->file_bytes();
+        oldest->file.close();
+        std::filesystem::remove(segment_path(options_.dir, oldest->seq, ".seg"), ec);
+        std::filesystem::remove(oldest->index_path(options_.dir), ec);
+        segments_.erase(segments_.begin());
+    }
+}
+
+bool SegmentStore::record(const Registry& registry, int64_t ts_ms) {
+    ++cycle_;
+    current_.clear();
+    registry.visit([&](const std::string& name, const MetricSeries& ms) {
+        auto [it, inserted] = known_.try_emplace(ms.id);
+        if (inserted) {
+            it->second.name   = name;
+            it->second.labels = ms.labels;
+        }
+        it->second.seen = cycle_;
+        current_.push_back({ms.id, std::bit_cast<uint64_t>(ms.current())});
+    });
+
+    std::unique_lock lock(mutex_);
+    // At most: the current block, a fresh block, a fresh segment.
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        Segment& seg = *segments_.back();
+        if (seg.head >= seg.block_count) {
+            if (!start_segment()) return false;
+            continue;
+        }
+
+        auto&  blk      = seg.blocks[seg.head];
+        bool   keyframe = blk.used == 0;
+        size_t need     = encode(ts_ms, keyframe);
+        if (blk.used + need <= seg.block_bytes) {
+            commit(ts_ms);
+            return true;
+        }
+        if (keyframe) break;   // Too many series for one block
+        ++seg.head;
+    }
+
+    // Not stored: forget series that are gone, the next keyframe drops them.
+    std::erase_if(known_, [&](const auto& kv) { return kv.second.seen != cycle_ && !kv.second.alive; });
+    return false;
+}
+
+size_t SegmentStore::encode(int64_t ts_ms, bool keyframe) {
+    const Segment& seg = *segments_.back();
+    scratch_.clear();
+    new_ids_.clear();
+    removed_refs_.clear();
+
+    auto begin_record = [&] {
+        size_t at = scratch_.size();
+        scratch_.append(RECORD_HEADER, '\0');
+        return at;
+    };
+    auto end_record = [&](size_t at) {
+        size_t len = scratch_.size() - at - RECORD_HEADER;
+        store_u32(scratch_.data() + at, static_cast<uint32_t>(len));
+        store_u32(scratch_.data() + at + 4, crc32(scratch_.data() + at + RECORD_HEADER, len));
+    };
+    auto ref_of = [&](const Known& k, uint32_t id) {
+        if (k.ref != NO_REF) return k.ref;
+        auto it = std::find(new_ids_.begin(), new_ids_.end(), id);
+        return static_cast<uint32_t>(seg.series.size() + static_cast<size_t>(it - new_ids_.begin()));
+    };
+
+    // Definitions first: a series number is always defined before it is used.
+    for (const auto& c : current_) {
+        const Known& k = known_.find(c.id)->second;
+        if (k.ref != NO_REF) continue;
+        size_t at = begin_record();
+        scratch_.push_back(static_cast<char>(RECORD_SERIES));
+        snapshot::put_varint(scratch_, seg.series.size() + new_ids_.size());
+        snapshot::put_string(scratch_, k.name);
+        snapshot::put_string(scratch_, k.labels);
+        end_record(at);
+        new_ids_.push_back(c.id);
+    }
+
+    size_t at = begin_record();
+    scratch_.push_back(static_cast<char>(RECORD_SAMPLES));
+    scratch_.push_back(static_cast<char>(keyframe ? FLAG_KEYFRAME : 0));
+    snapshot::put_varint(scratch_, static_cast<uint64_t>(ts_ms));
+
+    size_t changed = 0;
+    for (const auto& c : current_) {
+        const Known& k = known_.find(c.id)->second;
+        if (keyframe || !k.alive || c.bits != k.last_bits) ++changed;
+    }
+    snapshot::put_varint(scratch_, changed);
+    for (const auto& c : current_) {
+        const Known& k = known_.find(c.id)->second;
+        if (!(keyframe || !k.alive || c.bits != k.last_bits)) continue;
+        snapshot::put_varint(scratch_, ref_of(k, c.id));
+        snapshot::put_double(scratch_, std::bit_cast<double>(c.bits));
+    }
+
+    if (!keyframe) {
+        for (const auto& [id, k] : known_) {
+            if (k.alive && k.seen != cycle_) removed_refs_.push_back(k.ref);
+        }
+    }
+    snapshot::put_varint(scratch_, removed_refs_.size());
+    for (uint32_t ref : removed_refs_) snapshot::put_varint(scratch_, ref);
+    end_record(at);
+
+    return scratch_.size();
+}
+
+void SegmentStore::commit(int64_t ts_ms) {
+    Segment& seg = *segments_.back();
+    auto&    blk = seg.blocks[seg.head];
+    size_t   off = HEADER_BYTES + seg.head * seg.block_bytes + blk.used;
+    std::memcpy(seg.file.data() + off, scratch_.data(), scratch_.size());
+    seg.file.flush(off, scratch_.size(), false);
+
+    for (uint32_t id : new_ids_) {
+        Known& k = known_.find(id)->second;
+        k.ref = static_cast<uint32_t>(seg.series.size());
+        seg.series.push_back({k.name, k.labels, ts_ms, OPEN_ENDED});
+    }
+    for (const auto& c : current_) {
+        Known& k = known_.find(c.id)->second;
+        k.alive     = true;
+        k.last_bits = c.bits;
+    }
+    // Series gone from the registry end at the previous record.
+    for (auto it = known_.begin(); it != known_.end();) {
+        if (it->second.seen == cycle_) { ++it; continue; }
+        if (it->second.ref != NO_REF) seg.series[it->second.ref].last_ts = seg.last_ts;
+        it = known_.erase(it);
+    }
+
+    blk.used    += static_cast<uint32_t>(scratch_.size());
+    blk.first_ts = std::min(blk.first_ts, ts_ms);
+    blk.last_ts  = ts_ms;
+    seg.last_ts  = ts_ms;
+}
+
+std::vector<TimeSeriesStore::SeriesData> SegmentStore::query(const std::string& metric, int64_t start_ms,
+                                                             int64_t end_ms, int64_t step_ms,
+                                                             Aggregation agg) const {
+    std::vector<TimeSeriesStore::SeriesData> result;
+    std::vector<TimeSeriesStore::Downsampler> samplers;
+    if (end_ms < start_ms) return result;
+    const int64_t from = TimeSeriesStore::Downsampler(start_ms, end_ms, step_ms).from();
+
+    std::unordered_map<std::string, size_t> out_of_labels;
+    std::vector<int32_t> local_of_ref;   // Series number -> index into the arrays below, or -1
+    std::vector<size_t>  out_of_local;
+    std::vector<double>  value;
+    std::vector<uint8_t> alive;
+
+    std::shared_lock lock(mutex_);
+    for (const auto& segp : segments_) {
+        const Segment& seg = *segp;
+        if (seg.last_ts < from || seg.first_ts() > end_ms) continue;
+
+        local_of_ref.assign(seg.series.size(), -1);
+        out_of_local.clear();
+        for (size_t ref = 0; ref < seg.series.size(); ++ref) {
+            const auto& s = seg.series[ref];
+            if (s.name != metric || s.first_ts > end_ms || s.last_ts < from) continue;
+            auto [it, inserted] = out_of_labels.try_emplace(s.labels, result.size());
+            if (inserted) {
+                result.push_back({s.labels, {}});
+                samplers.emplace_back(start_ms, end_ms, step_ms, agg);
+            }
+            local_of_ref[ref] = static_cast<int32_t>(out_of_local.size());
+            out_of_local.push_back(it->second);
+        }
+        if (out_of_local.empty()) continue;
+
+        bool past_end = false;
+        for (uint32_t b = 0; b < seg.block_count && !past_end; ++b) {
+            const auto& blk = seg.blocks[b];
+            if (blk.used == 0 || blk.first_ts > end_ms) break;
+            if (blk.last_ts < from) continue;
+
+            // Every block starts with a keyframe, so it decodes on its own.
+            value.assign(out_of_local.size(), 0.0);
+            alive.assign(out_of_local.size(), 0);
+            const char* base = seg.block(b);
+            for (size_t off = 0; off + RECORD_HEADER <= blk.used && !past_end;) {
+                uint32_t len = load_u32(base + off);
+                if (len == 0 || len > blk.used - off - RECORD_HEADER) break;
+                snapshot::Reader r(std::string_view(base + off + RECORD_HEADER, len));
+                off += RECORD_HEADER + len;
+
+                uint8_t type, flags;
+                uint64_t ts, count;
+                if (!r.get_u8(type) || type != RECORD_SAMPLES) continue;
+                if (!r.get_u8(flags) || !r.get_varint(ts) || !r.get_varint(count)) break;
+                if (flags & FLAG_KEYFRAME) std::fill(alive.begin(), alive.end(), 0);
+
+                bool ok = true;
+                for (uint64_t i = 0; i < count && ok; ++i) {
+                    uint64_t ref;
+                    double   v;
+                    ok = r.get_varint(ref) && r.get_double(v);
+                    if (!ok || ref >= local_of_ref.size() || local_of_ref[ref] < 0) continue;
+                    auto l = static_cast<size_t>(local_of_ref[ref]);
+                    value[l] = v;
+                    alive[l] = 1;
+                }
+                uint64_t removed = 0;
+                ok = ok && r.get_varint(removed);
+                for (uint64_t i = 0; i < removed && ok; ++i) {
+                    uint64_t ref;
+                    ok = r.get_varint(ref);
+                    if (ok && ref < local_of_ref.size() && local_of_ref[ref] >= 0)
+                        alive[static_cast<size_t>(local_of_ref[ref])] = 0;
+                }
+                if (!ok) break;
+
+                auto t = static_cast<int64_t>(ts);
+                if (t < from) continue;
+                if (t > end_ms) { past_end = true; break; }
+                for (size_t l = 0; l < out_of_local.size(); ++l) {
+                    if (!alive[l]) continue;
+                    size_t o = out_of_local[l];
+                    samplers[o].add(result[o].points, t, value[l]);
+                }
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end(),
+              [](const auto& a, const auto& b) { return a.labels < b.labels; });
+    return result;
+}
+
+size_t SegmentStore::segment_count() const {
+    std::shared_lock lock(mutex_);
+    return segments_.size();
+}
+
+uint64_t SegmentStore::disk_bytes() const {
+    std::shared_lock lock(mutex_);
+    uint64_t total = 0;
+    for (const auto& s : segments_) total += s->file_bytes();
+    return total;
+}
+
+}
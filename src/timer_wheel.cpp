@@ -0,0 +1,23 @@
+#include "third_eye/timer_wheel.hpp"
+
+namespace third_eye {
+
+TimerWheel::TimerWheel(uint32_t tick_ms, size_t slots)
+    : tick_ms_(tick_ms ? tick_ms : 1)
+    , slots_(slots ? slots : 1) {}
+
+void TimerWheel::schedule(uint32_t id, uint64_t due) {
+    slots_[due % slots_.size()].push_back({id, due});
+}
+
+void TimerWheel::advance(uint64_t tick, std::vector<uint32_t>& fired) {
+    auto& slot = slots_[tick % slots_.size()];
+    size_t keep = 0;
+    for (size_t i = 0; i < slot.size(); ++i) {
+        if (slot[i].due <= tick) fired.push_back(slot[i].id);
+        else                     slot[keep++] = slot[i];
+    }
+    slot.resize(keep);
+}
+
+}
@@ -0,0 +1,422 @@
+#include "third_eye/timeseries.hpp"
+#include "third_eye/registry.hpp"
+
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <algorithm>
+
+namespace third_eye {
+
+// Worst case for one sample: 4 + 32 bits of timestamp, 2 + 5 + 6 + 64 of value.
+static constexpr uint32_t MAX_SAMPLE_BITS = 113;
+static constexpr uint8_t  NO_WINDOW       = 0xff;
+
+
+struct TimeSeriesStore::Chunk {
+    int64_t  first_ts   = 0;
+    int64_t  last_ts    = 0;
+    uint32_t count      = 0;
+    uint32_t bits       = 0;
+
+    // Encoder state carried between appends.
+    int64_t  prev_delta = 0;
+    uint64_t prev_value = 0;
+    uint8_t  prev_lead  = NO_WINDOW;
+    uint8_t  prev_trail = 0;
+
+    uint8_t  data[CHUNK_BYTES];
+
+    void reset() {
+        first_ts = last_ts = 0;
+        count = bits = 0;
+        prev_delta = 0;
+        prev_value = 0;
+        prev_lead  = NO_WINDOW;
+        prev_trail = 0;
+        std::memset(data, 0, sizeof(data));
+    }
+
+    /// False if the next sample might not fit, or its timestamp delta-of-
+    /// delta would not fit the 32-bit escape; the caller starts a new chunk.
+    [[nodiscard]] bool accepts(int64_t ts) const {
+        if (count == 0) return true;
+        if (bits + MAX_SAMPLE_BITS > CHUNK_BYTES * 8) return false;
+        int64_t dod = (ts - last_ts) - prev_delta;
+        return dod > INT32_MIN && dod < INT32_MAX && ts >= last_ts;
+    }
+
+    void put(uint64_t value, unsigned n) {
+        for (unsigned i = n; i-- > 0;) {
+            if ((value >> i) & 1u) data[bits >> 3] |= static_cast<uint8_t>(0x80u >> (bits & 7));
+            ++bits;
+        }
+    }
+
+    void append(int64_t ts, double v) {
+        uint64_t vb = std::bit_cast<uint64_t>(v);
+
+        if (count == 0) {
+            put(static_cast<uint64_t>(ts), 64);
+            put(vb, 64);
+            first_ts = last_ts = ts;
+            prev_value = vb;
+            count = 1;
+            return;
+        }
+
+        int64_t delta = ts - last_ts;
+        int64_t dod   = delta - prev_delta;
+        if (dod == 0) {
+            put(0b0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            put(0b10, 2);
+            put(static_cast<uint64_t>(dod + 63), 7);
+        } else if (dod >= -255 && dod <= 256) {
+            put(0b110, 3);
+            put(static_cast<uint64_t>(dod + 255), 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            put(0b1110, 4);
+            put(static_cast<uint64_t>(dod + 2047), 12);
+        } else {
+            put(0b1111, 4);
+            put(static_cast<uint32_t>(static_cast<int32_t>(dod)), 32);
+        }
+
+        uint64_t x = vb ^ prev_value;
+        if (x == 0) {
+            put(0b0, 1);
+        } else {
+            auto lead  = static_cast<uint8_t>(std::min(std::countl_zero(x), 31));
+            auto trail = static_cast<uint8_t>(std::countr_zero(x));
+            if (prev_lead != NO_WINDOW && lead >= prev_lead && trail >= prev_trail) {
+                put(0b10, 2);
+                put(x >> prev_trail, 64u - prev_lead - prev_trail);
+            } else {
+                unsigned sig = 64u - lead - trail;
+                put(0b11, 2);
+                put(lead, 5);
+                put(sig - 1, 6);
+                put(x >> trail, sig);
+                prev_lead  = lead;
+                prev_trail = trail;
+            }
+        }
+
+        last_ts    = ts;
+        prev_delta = delta;
+        prev_value = vb;
+        ++count;
+    }
+
+    /// Calls fn(ts, value) for each sample in order; stops when fn returns false.
+    template <typename Fn>
+    void decode(Fn&& fn) const {
+        uint32_t pos = 0;
+        auto get = [&](unsigned n) {
+            uint64_t v = 0;
+            for (unsigned i = 0; i < n; ++i, ++pos)
+                v = (v << 1) | ((data[pos >> 3] >> (7 - (pos & 7))) & 1u);
+            return v;
+        };
+
+        if (count == 0) return;
+        auto     ts    = static_cast<int64_t>(get(64));
+        uint64_t vb    = get(64);
+        int64_t  delta = 0;
+        unsigned lead = 0, trail = 0;
+        if (!fn(ts, std::bit_cast<double>(vb))) return;
+
+        for (uint32_t i = 1; i < count; ++i) {
+            int64_t dod;
+            if (get(1) == 0)      dod = 0;
+            else if (get(1) == 0) dod = static_cast<int64_t>(get(7)) - 63;
+            else if (get(1) == 0) dod = static_cast<int64_t>(get(9)) - 255;
+            else if (get(1) == 0) dod = static_cast<int64_t>(get(12)) - 2047;
+            else                  dod = static_cast<int32_t>(static_cast<uint32_t>(get(32)));
+            delta += dod;
+            ts    += delta;
+
+            if (get(1) == 1) {
+                if (get(1) == 1) {
+                    lead  = static_cast<unsigned>(get(5));
+                    unsigned sig = static_cast<unsigned>(get(6)) + 1;
+                    trail = 64 - lead - sig;
+                }
+                vb ^= get(64 - lead - trail) << trail;
+            }
+            if (!fn(ts, std::bit_cast<double>(vb))) return;
+        }
+    }
+};
+
+
+/// Samples with timestamps in (end_ts - tier width, end_ts].
+struct TimeSeriesStore::Bucket {
+    int64_t  end_ts;
+    double   min;
+    double   max;
+    double   sum;
+    double   last;
+    uint32_t count;
+};
+
+
+struct TimeSeriesStore::Series {
+    std::string name;
+    std::string labels;
+    uint32_t    id = 0;
+    std::vector<std::unique_ptr<Chunk>> ring;   // Grows to chunks_per_series, then wraps
+    size_t      head = 0;                       // Chunk currently appended to
+
+    // Same ring scheme, one per tier: grows to tier_buckets, then wraps.
+    std::vector<Bucket> tiers[TIER_COUNT];
+    size_t      tier_head[TIER_COUNT] = {};
+};
+
+
+bool parse_aggregation(std::string_view name, Aggregation& out) {
+    if      (name == "last") out = Aggregation::Last;
+    else if (name == "avg")  out = Aggregation::Avg;
+    else if (name == "min")  out = Aggregation::Min;
+    else if (name == "max")  out = Aggregation::Max;
+    else return false;
+    return true;
+}
+
+
+TimeSeriesStore::TimeSeriesStore() : TimeSeriesStore(Options{}) {}
+
+TimeSeriesStore::TimeSeriesStore(Options options) : options_(std::move(options)) {
+    if (options_.chunks_per_series < 2) options_.chunks_per_series = 2;
+    size_t full = sizeof(Series) + options_.chunks_per_series * sizeof(Chunk);
+    for (auto& n : options_.tier_buckets) {
+        n = std::max<size_t>(n, 2);
+        full += n * sizeof(Bucket);
+    }
+    options_.max_series = std::clamp<size_t>(options_.max_bytes / full, 1, options_.max_series);
+}
+
+TimeSeriesStore::~TimeSeriesStore() = default;
+
+void TimeSeriesStore::release(size_t slot) {
+    auto& s = slots_[slot];
+    chunk_count_ -= s->ring.size();
+    for (const auto& ring : s->tiers) bucket_count_ -= ring.capacity();
+    slot_of_id_.erase(s->id);
+    s.reset();
+    free_slots_.push_back(static_cast<uint32_t>(slot));
+    --live_series_;
+}
+
+/// Frees up to an eighth of max_series, taking the series that have been
+/// gone from the registry longest. False if every series is still live.
+bool TimeSeriesStore::evict_gone() {
+    // During a record() pass last_ts_ is still the previous pass, which
+    // every live series was part of.
+    std::vector<std::pair<int64_t, size_t>> gone;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        const auto& s = slots_[i];
+        if (!s || s->ring.empty()) continue;
+        int64_t newest = s->ring[s->head]->last_ts;
+        if (newest < last_ts_) gone.emplace_back(newest, i);
+    }
+    if (gone.empty()) return false;
+
+    size_t n = std::min(gone.size(), std::max<size_t>(options_.max_series / 8, 1));
+    std::nth_element(gone.begin(), gone.begin() + static_cast<ptrdiff_t>(n - 1), gone.end());
+    for (size_t i = 0; i < n; ++i) release(gone[i].second);
+    return true;
+}
+
+size_t TimeSeriesStore::record(const Registry& registry, int64_t ts_ms) {
+    std::unique_lock lock(mutex_);
+
+    size_t dropped = 0;
+    bool   can_evict = true;   // Once per pass: after a fruitless scan, nothing else is gone
+    const std::string* family = nullptr;
+    bool   skip = false;
+    registry.visit([&](const std::string& name, const MetricSeries& ms) {
+        if (&name != family) {
+            family = &name;
+            skip   = options_.skip_metrics.contains(name);
+        }
+        if (skip) return;
+
+        uint32_t slot;
+        if (auto found = slot_of_id_.find(ms.id); found != slot_of_id_.end()) {
+            slot = found->second;
+        } else {
+            if (live_series_ >= options_.max_series && can_evict) can_evict = evict_gone();
+            if (live_series_ >= options_.max_series) {
+                ++dropped;
+                return;
+            }
+            auto s = std::make_unique<Series>();
+            s->name   = name;
+            s->labels = ms.labels;
+            s->id     = ms.id;
+            // Tier rings get their full size up front, so memory_bytes() is exact.
+            for (size_t t = 0; t < TIER_COUNT; ++t) {
+                s->tiers[t].reserve(options_.tier_buckets[t]);
+                bucket_count_ += s->tiers[t].capacity();
+            }
+            if (!free_slots_.empty()) {
+                slot = free_slots_.back();
+                free_slots_.pop_back();
+                slots_[slot] = std::move(s);
+            } else {
+                slot = static_cast<uint32_t>(slots_.size());
+                slots_.push_back(std::move(s));
+            }
+            slot_of_id_[ms.id] = slot;
+            ++live_series_;
+        }
+
+        Series& s = *slots_[slot];
+        if (s.ring.empty()) {
+            s.ring.push_back(std::make_unique<Chunk>());
+            s.ring.back()->reset();
+            ++chunk_count_;
+        } else if (!s.ring[s.head]->accepts(ts_ms)) {
+            if (s.ring.size() < options_.chunks_per_series) {
+                s.ring.push_back(std::make_unique<Chunk>());
+                s.head = s.ring.size() - 1;
+                ++chunk_count_;
+            } else {
+                s.head = (s.head + 1) % s.ring.size();   // Overwrite the oldest
+            }
+            s.ring[s.head]->reset();
+        }
+        double v = ms.current();
+        s.ring[s.head]->append(ts_ms, v);
+
+        for (size_t t = 0; t < TIER_COUNT; ++t) {
+            auto&   ring  = s.tiers[t];
+            size_t& head  = s.tier_head[t];
+            int64_t width = TIER_WIDTH_MS[t];
+            int64_t end   = (ts_ms + width - 1) / width * width;
+
+            // A clock stepped backwards keeps adding to the newest bucket.
+            if (!ring.empty() && end <= ring[head].end_ts) {
+                Bucket& b = ring[head];
+                b.min  = std::min(b.min, v);
+                b.max  = std::max(b.max, v);
+                b.sum += v;
+                b.last = v;
+                ++b.count;
+                continue;
+            }
+            if (ring.size() < options_.tier_buckets[t]) {
+                ring.push_back({});
+                head = ring.size() - 1;
+            } else {
+                head = (head + 1) % ring.size();   // Overwrite the oldest
+            }
+            ring[head] = {end, v, v, v, v, 1};
+        }
+    });
+    first_ts_ = std::min(first_ts_, ts_ms);
+    last_ts_  = std::max(last_ts_, ts_ms);
+
+    // Series gone from the registry keep their history until it goes stale.
+    if (++record_calls_ % 60 == 0) {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            auto& s = slots_[i];
+            if (!s || s->ring.empty()) continue;
+            if (ts_ms - s->ring[s->head]->last_ts < options_.stale_after_ms) continue;
+            release(i);
+        }
+    }
+    return dropped;
+}
+
+int64_t TimeSeriesStore::resolution_for(int64_t step_ms) {
+    for (size_t t = TIER_COUNT; t-- > 0;) {
+        if (TIER_WIDTH_MS[t] <= step_ms) return TIER_WIDTH_MS[t];
+    }
+    return 0;
+}
+
+int64_t TimeSeriesStore::retained_since(int64_t step_ms) const {
+    std::shared_lock lock(mutex_);
+    if (first_ts_ > last_ts_) return INT64_MAX;
+
+    int64_t width = resolution_for(step_ms);
+    for (size_t t = 0; t < TIER_COUNT; ++t) {
+        if (TIER_WIDTH_MS[t] != width) continue;
+        int64_t span = width * static_cast<int64_t>(options_.tier_buckets[t]);
+        return std::max(first_ts_, (last_ts_ + width - 1) / width * width - span);
+    }
+
+    // Raw rings wrap per series: the window is complete from the newest of their oldest chunks.
+    int64_t since = first_ts_;
+    for (const auto& s : slots_) {
+        if (!s || s->ring.size() < options_.chunks_per_series) continue;
+        since = std::max(since, s->ring[(s->head + 1) % s->ring.size()]->first_ts);
+    }
+    return since;
+}
+
+std::vector<TimeSeriesStore::SeriesData> TimeSeriesStore::query(const std::string& metric,
+                                                                int64_t start_ms, int64_t end_ms,
+                                                                int64_t step_ms, Aggregation agg) const {
+    std::vector<SeriesData> result;
+    if (end_ms < start_ms) return result;
+
+    // Coarsest tier whose buckets fit in one step, if any.
+    size_t tier = TIER_COUNT;
+    for (size_t t = 0; t < TIER_COUNT; ++t) {
+        if (TIER_WIDTH_MS[t] <= step_ms) tier = t;
+    }
+
+    std::shared_lock lock(mutex_);
+    for (const auto& s : slots_) {
+        if (!s || s->name != metric) continue;
+
+        SeriesData out;
+        out.labels = s->labels;
+        Downsampler sampler(start_ms, end_ms, step_ms, agg);
+
+        if (tier < TIER_COUNT) {
+            const auto& ring = s->tiers[tier];
+            size_t n     = ring.size();
+            size_t first = (n < options_.tier_buckets[tier]) ? 0 : (s->tier_head[tier] + 1) % n;
+            for (size_t k = 0; k < n; ++k) {
+                // The newest bucket is still filling; it ends, for now, at the last sample.
+                const Bucket& b = ring[(first + k) % n];
+                int64_t ts = std::min(b.end_ts, last_ts_);
+                if (!sampler.add(out.points, ts, b.min, b.max, b.sum, b.count, b.last)) break;
+            }
+            result.push_back(std::move(out));
+            continue;
+        }
+
+        size_t n     = s->ring.size();
+        size_t first = (n < options_.chunks_per_series) ? 0 : (s->head + 1) % n;
+
+        for (size_t k = 0; k < n; ++k) {
+            const Chunk& c = *s->ring[(first + k) % n];
+            if (c.count == 0 || c.last_ts < sampler.from() || c.first_ts > end_ms) continue;
+            c.decode([&](int64_t ts, double v) { return sampler.add(out.points, ts, v); });
+        }
+        result.push_back(std::move(out));
+    }
+
+    std::sort(result.begin(), result.end(),
+              [](const SeriesData& a, const SeriesData& b) { return a.labels < b.labels; });
+    return result;
+}
+
+size_t TimeSeriesStore::series_count() const {
+    std::shared_lock lock(mutex_);
+    return live_series_;
+}
+
+size_t TimeSeriesStore::memory_bytes() const {
+    std::shared_lock lock(mutex_);
+    return chunk_count_ * sizeof(Chunk) + bucket_count_ * sizeof(Bucket) + live_series_ * sizeof(Series) +
+           slot_of_id_.size() * (sizeof(uint32_t) * 2 + sizeof(void*) * 2);
+}
+
+}
@@ -1,7 +1,7 @@
 import React, { useState, useEffect, useCallback } from 'react';
 import { Icon } from 'fontnotawesome';
 import 'fontnotawesome/css/all.css';
-import { fetchStatus, fetchAlerts } from './services/agentApi.js';
+import { fetchStatus, subscribe, streamSupported } from './services/agentApi.js';
 import Dashboard from './components/Dashboard.jsx';
 import LogViewer from './components/LogViewer.jsx';
 import Settings from './components/Settings.jsx';
@@ -34,32 +34,51 @@ export default function App() {
         }
     }, []);
 
+    const applyStatus = useCallback((data) => {
+        setStatus(data);
+        setConnected(true);
+        setAlertCount(data.active_alerts_count || 0);
+        setHistory(prev => {
+            const next = [...prev, {
+                time: Date.now(),
+                cpu: data.cpu_usage_percent,
+                mem: data.memory_total_bytes ? (data.memory_used_bytes / data.memory_total_bytes * 100) : 0,
+                collectDur: data.collect_duration_seconds || 0,
+                scrapeDur: data.scrape_duration_seconds || 0,
+            }];
+            return next.length > MAX_HISTORY ? next.slice(-MAX_HISTORY) : next;
+        });
+    }, []);
+
     const pollStatus = useCallback(async () => {
         try {
-            const data = await fetchStatus();
-            setStatus(data);
-            setConnected(true);
-            setAlertCount(data.active_alerts_count || 0);
-            setHistory(prev => {
-                const next = [...prev, {
-                    time: Date.now(),
-                    cpu: data.cpu_usage_percent,
-                    mem: data.memory_total_bytes ? (data.memory_used_bytes / data.memory_total_bytes * 100) : 0,
-                    collectDur: data.collect_duration_seconds || 0,
-                    scrapeDur: data.scrape_duration_seconds || 0,
-                }];
-                return next.length > MAX_HISTORY ? next.slice(-MAX_HISTORY) : next;
-            });
+            applyStatus(await fetchStatus());
         } catch {
             setConnected(false);
         }
-    }, []);
+    }, [applyStatus]);
 
     useEffect(() => {
-        pollStatus();
-        const id = setInterval(pollStatus, 1000);
-        return () => clearInterval(id);
-    }, [pollStatus]);
+        if (!streamSupported()) {
+            pollStatus();
+            const id = setInterval(pollStatus, 1000);
+            return () => clearInterval(id);
+        }
+
+        // The stream opens with a full 'status' snapshot, then sends only
+        // the fields that changed in each collection cycle.
+        let current = null;
+        const unsubs = [
+            subscribe('status', (data) => { current = data; applyStatus(current); }),
+            subscribe('metrics', (delta) => {
+                if (!current) return;
+                current = { ...current, ...delta };
+                applyStatus(current);
+            }),
+            subscribe('error', () => setConnected(false)),
+        ];
+        return () => unsubs.forEach(u => u());
+    }, [pollStatus, applyStatus]);
 
     const renderPage = () => {
         switch (page) {
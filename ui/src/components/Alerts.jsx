@@ -1,6 +1,6 @@
 import React, { useState, useEffect, useCallback } from 'react';
 import { Icon } from 'fontnotawesome';
-import { fetchAlerts } from '../services/agentApi.js';
+import { fetchAlerts, subscribe, streamSupported } from '../services/agentApi.js';
 
 const TYPE_ICONS = {
     cpu_high: 'microchip',
@@ -45,8 +45,12 @@ export default function Alerts() {
 
     useEffect(() => {
         poll();
-        const id = setInterval(poll, 2000);
-        return () => clearInterval(id);
+        if (!streamSupported()) {
+            const id = setInterval(poll, 2000);
+            return () => clearInterval(id);
+        }
+        // Alert transitions are rare; refetch the history when one arrives.
+        return subscribe('alert', () => poll());
     }, [poll]);
 
     const active = data?.active || [];
@@ -1,6 +1,6 @@
 import React, { useState, useEffect, useRef, useCallback } from 'react';
 import { Icon } from 'fontnotawesome';
-import { fetchLogs } from '../services/agentApi.js';
+import { fetchLogs, subscribe, streamSupported } from '../services/agentApi.js';
 import { useToast, Toast } from './Toast.jsx';
 
 const LEVELS = ['ALL', 'INFO', 'DEBUG', 'ERROR'];
@@ -12,22 +12,42 @@ export default function LogViewer() {
     const [autoScroll, setAutoScroll] = useState(true);
     const [paused, setPaused] = useState(false);
     const containerRef = useRef(null);
+    const lastSeq = useRef(0);
     const { toast, show: showToast } = useToast();
 
+    // After the first fetch, only ask for records newer than the last one seen.
     const pollLogs = useCallback(async () => {
         if (paused) return;
         try {
             const filterLevel = level === 'ALL' ? '' : level;
-            const data = await fetchLogs(filterLevel, 500);
-            setLogs(data.logs || []);
+            const since = lastSeq.current;
+            const data = await fetchLogs(filterLevel, 500, since);
+            const fresh = data.logs || [];
+            lastSeq.current = data.last_seq || 0;
+            setLogs(prev => {
+                if (!since) return fresh;
+                const next = [...prev, ...fresh];
+                return next.length > 500 ? next.slice(-500) : next;
+            });
         } catch { }
     }, [level, paused]);
 
     useEffect(() => {
+        lastSeq.current = 0;
         pollLogs();
-        const id = setInterval(pollLogs, 1500);
-        return () => clearInterval(id);
-    }, [pollLogs]);
+        if (!streamSupported()) {
+            const id = setInterval(pollLogs, 1500);
+            return () => clearInterval(id);
+        }
+        return subscribe('log', (entry) => {
+            if (paused) return;
+            if (level !== 'ALL' && entry.level !== level) return;
+            setLogs(prev => {
+                const next = [...prev, entry];
+                return next.length > 500 ? next.slice(-500) : next;
+            });
+        });
+    }, [pollLogs, level, paused]);
 
     useEffect(() => {
         if (autoScroll && containerRef.current) {
@@ -6,10 +6,11 @@ export async function fetchStatus() {
     return res.json();
 }
 
-export async function fetchLogs(level = '', limit = 500) {
+export async function fetchLogs(level = '', limit = 500, since = 0) {
     const params = new URLSearchParams();
     if (level) params.set('level', level);
     params.set('limit', String(limit));
+    if (since) params.set('since', String(since));
     const res = await fetch(`${BASE}/api/logs?${params}`, { signal: AbortSignal.timeout(3000) });
     if (!res.ok) throw new Error(`HTTP ${res.status}`);
     return res.json();
@@ -40,3 +41,44 @@ export async function testConnection() {
         return { ok: false, error: e.message };
     }
 }
+
+// --- Server-Sent Events ----------------------------------------------------
+// One shared EventSource on /api/stream replaces the status, log and alert
+// polls. Components subscribe to named events ('status', 'metrics', 'log',
+// 'alert', plus 'open'/'error' for connection state); the connection is
+// opened on the first subscription and closed after the last one leaves.
+
+let stream = null;
+const listeners = new Map();
+
+function dispatch(event, payload) {
+    for (const fn of listeners.get(event) || []) fn(payload);
+}
+
+function openStream() {
+    stream = new EventSource(`${BASE}/api/stream`);
+    stream.onopen = () => dispatch('open');
+    stream.onerror = () => dispatch('error');
+    for (const event of ['status', 'metrics', 'log', 'alert']) {
+        stream.addEventListener(event, (e) => dispatch(event, JSON.parse(e.data)));
+    }
+}
+
+export function streamSupported() {
+    return typeof EventSource !== 'undefined';
+}
+
+export function subscribe(event, handler) {
+    if (!listeners.has(event)) listeners.set(event, new Set());
+    listeners.get(event).add(handler);
+    if (!stream) openStream();
+
+    return () => {
+        listeners.get(event)?.delete(handler);
+        const remaining = [...listeners.values()].reduce((n, set) => n + set.size, 0);
+        if (remaining === 0 && stream) {
+            stream.close();
+            stream = null;
+        }
+    };
+}